@@ -13,8 +13,14 @@ RECOMP_IMPORT("magemods_audio_api", bool AudioApi_AddSequenceFromFs(AudioApiSequ
 RECOMP_IMPORT("magemods_audio_api", bool AudioApi_AddSoundFontFromFs(AudioApiSoundFontInfo* info, char* dir, char* filename));
 RECOMP_IMPORT("magemods_audio_api", bool AudioApi_AddSampleBankFromFs(AudioApiSampleBankInfo* info, char* dir, char* filename));
 RECOMP_IMPORT("magemods_audio_api", bool AudioApi_AddAudioFileFromFs(AudioApiFileInfo* info, char* dir, char* filename));
+RECOMP_IMPORT("magemods_audio_api", u32 AudioApi_AddAudioFilesFromFs(AudioApiFileInfo* infos, char* dir, char** filenames, u32 count));
 RECOMP_IMPORT("magemods_audio_api", uintptr_t AudioApi_GetResourceDevAddr(u32 resourceId));
 
+RECOMP_IMPORT("magemods_audio_api", bool AudioApi_SetOption(AudioApiOption option, u32 value));
+RECOMP_IMPORT("magemods_audio_api", bool AudioApi_SetCacheQuota(char* dir, u32 bytes));
+RECOMP_IMPORT("magemods_audio_api", u32 AudioApi_GetUnderrunCount(s32 resourceId));
+RECOMP_IMPORT("magemods_audio_api", bool AudioApi_GetStats(s32 resourceId, AudioApiStats* stats));
+
 RECOMP_IMPORT("magemods_audio_api", s32 AudioApi_CreateStreamedSequence(AudioApiFileInfo* info));
 RECOMP_IMPORT("magemods_audio_api", s32 AudioApi_CreateStreamedBgm(AudioApiFileInfo* info, char* dir, char* filename));
 RECOMP_IMPORT("magemods_audio_api", s32 AudioApi_CreateStreamedFanfare(AudioApiFileInfo* info, char* dir, char* filename));
@@ -18,6 +18,8 @@ typedef int32_t s32;
 typedef int64_t s64;
 #endif
 
+#define AUDIOAPI_INVALID_RESOURCE_ID 0xFFFFFFFF
+
 typedef s32 (*AudioApiDmaCallback)(void* ramAddr, size_t size, size_t offset, u32 arg0, u32 arg1, u32 arg2);
 
 typedef enum {
@@ -33,6 +35,7 @@ typedef enum : u32 {                        // Note: specific implementation may
     AUDIOAPI_CACHE_PRELOAD,                 // Preload entire file
     AUDIOAPI_CACHE_PRELOAD_ON_USE,          // Preload upon DMA request
     AUDIOAPI_CACHE_PRELOAD_ON_USE_NO_EVICT, // Preload upon DMA request and never evict from cache
+    AUDIOAPI_CACHE_PRELOAD_ON_USE_NO_BLOCK, // Preload upon DMA request, and hold the last sample instead of waiting on a cache miss
 } AudioApiCacheStrategy;
 
 typedef enum : u32 {
@@ -42,14 +45,31 @@ typedef enum : u32 {
     AUDIOAPI_CODEC_MP3,
     AUDIOAPI_CODEC_VORBIS,
     AUDIOAPI_CODEC_OPUS,
+    AUDIOAPI_CODEC_PCM_PACK,                // Pre-decoded .apcm file made with audioapi_pack
 } AudioApiCodec;
 
+typedef enum : u32 {
+    AUDIOAPI_OPTION_CACHE_BUDGET,           // Total bytes of decoded audio kept in memory across all mods
+    AUDIOAPI_OPTION_WORKER_THREADS,         // Number of background decode threads, only grows once started
+    AUDIOAPI_OPTION_SPLIT_DECODERS,         // Preload audio files through a second decoder (default on)
+    AUDIOAPI_OPTION_DISK_CACHE,             // Keep decoded audio in mod_data/audio_cache between sessions (default on)
+    AUDIOAPI_OPTION_RESAMPLE_RATE,          // Resample files probed from now on to this rate while decoding, 0 to keep their own (default 0)
+    AUDIOAPI_OPTION_COMPRESSED_CACHE,       // Keep preloaded files compressed away from the playback position (default on)
+    AUDIOAPI_OPTION_TRACE,                  // Record a timeline of extlib activity, setting it back to 0 writes mod_data/audio_trace.json (default off)
+    AUDIOAPI_OPTION_STREAM_FORMAT,          // AudioApiStreamFormat of files added from now on (default AUDIOAPI_STREAM_FORMAT_PCM)
+} AudioApiOption;
+
 typedef enum : u32 {
     AUDIOAPI_CHANNEL_TYPE_DEFAULT,
     AUDIOAPI_CHANNEL_TYPE_MONO,
     AUDIOAPI_CHANNEL_TYPE_STEREO,
 } AudioApiChannelType;
 
+typedef enum : u32 {
+    AUDIOAPI_STREAM_FORMAT_PCM,             // Stream decoded samples as CODEC_S16
+    AUDIOAPI_STREAM_FORMAT_VADPCM,          // Encode to VADPCM on the worker threads and stream as CODEC_ADPCM
+} AudioApiStreamFormat;
+
 typedef struct AudioApiFileInfo {
     u32 resourceId;
     u32 trackCount;
@@ -73,4 +93,22 @@ typedef AudioApiResourceInfo AudioApiSequenceInfo;
 typedef AudioApiResourceInfo AudioApiSoundFontInfo;
 typedef AudioApiResourceInfo AudioApiSampleBankInfo;
 
+// Counters since startup, which wrap around at 32 bits, so compare two reads rather than one. Queue
+// depth and the decode totals per codec, indexed by AudioApiCodec, are always across all resources.
+typedef struct AudioApiStats {
+    u32 dmaCalls;
+    u32 bytesServed;
+    u32 chunkHits;
+    u32 chunkMisses;
+    u32 underruns;
+    u32 mainThreadDecodeUs;                 // Time the audio thread spent decoding chunks that weren't ready
+    u32 evictions;                          // Chunks, or whole raw files, dropped from cache by the budget or by gc
+    u32 evictedBytes;
+    u32 cacheBytes;                         // Decoded audio currently held in memory
+    u32 queueDepth;                         // Preload jobs waiting for a decode worker
+    u32 queueDepthMax;
+    u32 decodeUs[AUDIOAPI_CODEC_PCM_PACK + 1];
+    u32 decodeFrames[AUDIOAPI_CODEC_PCM_PACK + 1];
+} AudioApiStats;
+
 #endif
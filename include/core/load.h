@@ -16,5 +16,6 @@ typedef s32 (*AudioApiDmaCallback)(void* ramAddr, size_t size, size_t offset, u3
 uintptr_t AudioApi_AddDmaCallback(AudioApiDmaCallback callback, u32 arg0, u32 arg1, u32 arg2);
 uintptr_t AudioApi_AddDmaSubCallback(uintptr_t devAddr, u32 arg1, u32 arg2);
 s32 AudioApi_NativeDmaCallback(void* ramAddr, size_t size, size_t offset, u32 arg0, u32 arg1, u32 arg2);
+void* AudioApi_DmaCallbackData(uintptr_t devAddr, size_t size, size_t offset);
 
 #endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Cache {
+
+// Hands out equal sized chunk buffers carved from larger slabs, so decoding a chunk does not hit
+// the heap. A slab is released as soon as its last chunk is freed, which lets eviction actually
+// return memory.
+class ChunkPool {
+public:
+    static constexpr uint32_t CHUNKS_PER_SLAB = 16;
+
+    void reset(size_t chunkSamples);
+
+    uint32_t alloc();
+    void free(uint32_t slot);
+
+    int16_t* data(uint32_t slot) {
+        return slabs[slot / CHUNKS_PER_SLAB].data.get() + (slot % CHUNKS_PER_SLAB) * chunkSamples;
+    }
+
+    size_t chunkBytes() const { return chunkSamples * sizeof(int16_t); }
+    size_t usedBytes() const { return usedChunks * chunkBytes(); }
+
+private:
+    struct Slab {
+        std::unique_ptr<int16_t[]> data;
+        std::vector<uint32_t> free;
+    };
+
+    std::vector<Slab> slabs;
+    size_t chunkSamples = 0;
+    size_t usedChunks = 0;
+};
+
+} // namespace Cache
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Cache {
+
+// Maps chunk numbers to pool slots. Open addressing with linear probing keeps a lookup to one or
+// two cache lines, and backward shift deletion avoids tombstones so the table never degrades.
+class ChunkTable {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    ChunkTable();
+
+    uint32_t find(uint32_t chunkNo) const;
+    bool insert(uint32_t chunkNo, uint32_t slot);
+    uint32_t erase(uint32_t chunkNo);
+    void clear();
+
+    size_t size() const { return count; }
+
+    template <typename F>
+    void forEach(F&& fn) const {
+        for (const auto& entry : entries) {
+            if (entry.chunkNo != EMPTY) {
+                fn(entry.chunkNo, entry.slot);
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+    static constexpr size_t MIN_CAPACITY = 64;
+
+    struct Entry {
+        uint32_t chunkNo = EMPTY;
+        uint32_t slot = 0;
+    };
+
+    size_t home(uint32_t chunkNo) const;
+    void rehash(size_t capacity);
+
+    std::vector<Entry> entries;
+    size_t mask;
+    size_t count = 0;
+};
+
+} // namespace Cache
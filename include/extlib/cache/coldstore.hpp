@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Cache {
+
+// Losslessly compresses a plane of samples in rdram order. Each block of samples is predicted by
+// whichever fixed polynomial fits it best, and the residuals are Rice coded. Music usually ends up
+// at a bit over half its size, and decompressing is much cheaper than decoding again.
+void compressPlane(std::vector<uint8_t>& out, const int16_t* plane, size_t samples);
+void decompressPlane(const uint8_t* data, size_t size, int16_t* plane, size_t samples);
+
+// Second cache tier holding compressed planes, keyed the same way as the chunk table. Preloaded
+// files keep all of their audio here and only the part around the playback position as PCM.
+//
+// Not synchronized, the owning resource guards it with its cache lock.
+class ColdStore {
+public:
+    void store(uint32_t key, std::vector<uint8_t> data);
+    bool load(uint32_t key, int16_t* plane, size_t samples) const;
+    void erase(uint32_t key);
+
+    bool has(uint32_t key) const {
+        return planes.contains(key);
+    }
+
+    size_t size() const { return planes.size(); }
+    size_t usedBytes() const { return bytes; }
+
+    template <typename F>
+    void forEach(F&& fn) const {
+        for (const auto& [ key, data ] : planes) {
+            fn(key, data.size());
+        }
+    }
+
+private:
+    std::unordered_map<uint32_t, std::vector<uint8_t>> planes;
+    size_t bytes = 0;
+};
+
+} // namespace Cache
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <extlib/cache/mappedfile.hpp>
+#include <extlib/vfs/file.hpp>
+
+namespace fs = std::filesystem;
+
+namespace Cache {
+
+// Everything that decides the decoded output. A cache file is only reused when all of it matches.
+struct DiskCacheKey {
+    uint64_t sourceFingerprint;
+    uint64_t sourceSize;
+    uint32_t codec;
+    uint32_t trackCount;
+    uint32_t sampleRate;
+    uint32_t sampleCount;
+    uint32_t chunkFrames;
+    uint32_t planeStride;
+
+    bool operator==(const DiskCacheKey&) const = default;
+};
+
+// Decoded chunks of one audio file, kept in a memory mapped file under mod_data so later sessions
+// can play them without decoding. Chunks use the same planar layout as the in-memory cache.
+//
+// A committed chunk can be read right away, but is only marked present in the file once sync has
+// flushed its data, so a crash never leaves a chunk marked that has nothing behind it.
+//
+// Not synchronized, the owning resource guards it with its cache lock.
+class DiskCache {
+public:
+    DiskCache(const std::string& sourcePath, const DiskCacheKey& key);
+    ~DiskCache();
+
+    static void setDirectory(fs::path dir);
+    static bool isEnabled();
+    // Deletes cache files unused for a month, and the least recently used ones beyond 2 GiB
+    static void prune();
+
+    bool has(uint32_t chunkNo) const {
+        return chunkNo < numChunks && available[chunkNo] != 0;
+    }
+
+    bool complete() const {
+        return presentChunks == numChunks;
+    }
+
+    int16_t* data(uint32_t chunkNo) const {
+        return chunks + chunkNo * chunkSamples;
+    }
+
+    void commit(uint32_t chunkNo);
+
+    // Writes out the chunks committed since the last call, then marks them present. Blocks on disk
+    // I/O, so it belongs on the gc thread. Readers of the cache may hold the lock shared meanwhile.
+    void sync();
+
+    static std::atomic<bool> enabled;
+
+private:
+    struct Header;
+
+    static fs::path directory;
+
+    MappedFile map;
+    Header* header = nullptr;
+    uint8_t* present = nullptr;
+    int16_t* chunks = nullptr;
+    size_t chunksOffset = 0;
+    std::vector<uint8_t> available;
+    std::vector<uint32_t> pending;
+    size_t chunkSamples = 0;
+    uint32_t numChunks = 0;
+    uint32_t presentChunks = 0;
+};
+
+} // namespace Cache
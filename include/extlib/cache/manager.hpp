@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+#include <extlib/decoder/abstract.hpp>
+
+namespace fs = std::filesystem;
+
+namespace Cache {
+
+constexpr size_t DEFAULT_BUDGET = 512 * 1024 * 1024;
+
+// Relative cost of decoding a chunk again after it was evicted
+inline int decodeCost(Decoder::Type type) {
+    switch (type) {
+    case Decoder::Type::Wav:
+    case Decoder::Type::Pack:
+        return 1;
+    case Decoder::Type::Flac:
+        return 2;
+    case Decoder::Type::Mp3:
+        return 3;
+    case Decoder::Type::Vorbis:
+    case Decoder::Type::Opus:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+class Manager {
+public:
+    void setBudget(size_t bytes);
+    void setQuota(fs::path owner, size_t bytes);
+    void setOwner(size_t resourceId, fs::path owner);
+
+    void enforce();
+
+private:
+    std::atomic<size_t> budget = DEFAULT_BUDGET;
+    std::unordered_map<fs::path, size_t> quotas;
+    std::unordered_map<size_t, fs::path> owners;
+    std::mutex mutex;
+
+    size_t hand = 0;
+};
+
+} // namespace Cache
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace Cache {
+
+// A file mapped read/write into memory. Opening creates the file if needed and resizes it to the
+// requested size.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    void open(const fs::path& path, size_t size);
+    void close();
+    void flush();
+    void flush(size_t offset, size_t bytes);
+
+    uint8_t* data() const { return ptr; }
+    size_t size() const { return length; }
+
+private:
+#if defined(_WIN32)
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    uint8_t* ptr = nullptr;
+    size_t length = 0;
+};
+
+} // namespace Cache
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <extlib/vfs/file.hpp>
+
+namespace fs = std::filesystem;
+
+namespace Cache {
+
+// What probing found out about an audio file, enough to register it without a decoder
+struct ProbeEntry {
+    uint64_t size;
+    uint64_t fingerprint;
+    uint32_t codec;
+    uint32_t resampleRate;
+    uint32_t chunkFrames;
+    uint32_t trackCount;
+    uint32_t sampleRate;
+    uint32_t sampleCount;
+    uint32_t loopStart;
+    uint32_t loopEnd;
+    int32_t loopCount;
+};
+
+// Probe results from earlier sessions, keyed by where the file was loaded from. An entry is only
+// used while the file's size and fingerprint still match.
+class ProbeIndex {
+public:
+    void load(fs::path path);
+    void save();
+
+    bool find(const std::string& key, const Vfs::File& file, ProbeEntry& entry);
+    void store(const std::string& key, const Vfs::File& file, ProbeEntry entry);
+
+private:
+    fs::path path;
+    std::unordered_map<std::string, ProbeEntry> entries;
+    std::mutex mutex;
+    bool dirty = false;
+};
+
+} // namespace Cache
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <mutex>
@@ -12,6 +13,17 @@
 
 namespace Decoder {
 
+constexpr size_t DEFAULT_CHUNK_SIZE = 1024;
+constexpr size_t MAX_CHUNK_SIZE = 8192;
+
+// Rounds a chunk to the nearest whole number of codec frames, close to the default chunk size
+inline size_t alignChunkSize(size_t frameSize) {
+    if (frameSize == 0 || frameSize > MAX_CHUNK_SIZE) {
+        return DEFAULT_CHUNK_SIZE;
+    }
+    return std::max<size_t>(DEFAULT_CHUNK_SIZE / frameSize, 1) * frameSize;
+}
+
 enum class Type {
     Auto    = AUDIOAPI_CODEC_AUTO,
     Wav     = AUDIOAPI_CODEC_WAV,
@@ -19,6 +31,7 @@ enum class Type {
     Mp3     = AUDIOAPI_CODEC_MP3,
     Vorbis  = AUDIOAPI_CODEC_VORBIS,
     Opus    = AUDIOAPI_CODEC_OPUS,
+    Pack    = AUDIOAPI_CODEC_PCM_PACK,
 };
 
 inline Type parseType(uint32_t val) {
@@ -30,6 +43,7 @@ inline Type parseType(uint32_t val) {
     case Type::Mp3:
     case Type::Vorbis:
     case Type::Opus:
+    case Type::Pack:
         return type;
     default:
         return Type::Auto;
@@ -44,6 +58,18 @@ public:
     virtual void close() = 0;
     virtual void probe() = 0;
     virtual long decode(std::vector<int16_t>* buffer, size_t count, size_t offset) = 0;
+    virtual Type type() const = 0;
+
+    // Builds the seek index shared through metadata, if the codec needs one. Requires an open decoder.
+    virtual void index() {}
+
+    // Frames per cache chunk, known once probed
+    size_t chunkSize() const {
+        return chunkFrames;
+    }
+
+    virtual std::unique_ptr<Abstract> clone(std::shared_ptr<Vfs::File> file);
+    void restore(std::shared_ptr<Metadata> metadata, size_t chunkFrames);
 
     std::shared_ptr<Metadata> metadata;
 
@@ -52,6 +78,7 @@ protected:
         : file(file), metadata(std::make_shared<Metadata>()) {}
 
     bool firstOpen = true;
+    size_t chunkFrames = DEFAULT_CHUNK_SIZE;
     std::atomic<size_t> pos = 0;
 
     std::mutex mutex;
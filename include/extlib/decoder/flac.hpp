@@ -13,6 +13,8 @@ public:
     void close() override;
     void probe() override;
     long decode(std::vector<int16_t>* buffer, size_t count, size_t offset) override;
+    Type type() const override { return Type::Flac; };
+    void index() override;
 
     static size_t onRead(void* datasrc, void* ptr, size_t bytes);
     static drflac_bool32 onSeek(void* datasrc, int offset, drflac_seek_origin whence);
@@ -20,7 +22,11 @@ public:
     static void onMeta(void* datasrc, drflac_metadata* metadata);
 
 private:
+    void seek(size_t offset);
+
     drflac* decoder = nullptr;
+    // Read from the stream's metadata on first open, before the shared index is built
+    std::vector<SeekPoint> nativeSeekPoints;
 };
 
 } // namespace Decoder
@@ -3,6 +3,8 @@
 #include <map>
 #include <string>
 
+#include <extlib/decoder/seekindex.hpp>
+
 namespace Decoder {
 
 class Metadata {
@@ -33,6 +35,8 @@ public:
     uint32_t loopEnd = 0;
     int32_t loopCount = 0;
 
+    SeekIndex seekIndex;
+
 private:
     enum class LabelType {
         NONE,
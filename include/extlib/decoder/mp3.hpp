@@ -4,15 +4,22 @@
 
 namespace Decoder {
 
+// MPEG-1 Layer III, and a multiple of the 576 frames used by MPEG-2
+constexpr size_t MP3_FRAME_SIZE = 1152;
+
 class Mp3 : public Abstract {
 public:
-    Mp3(std::shared_ptr<Vfs::File> file) : Abstract(file) {};
+    Mp3(std::shared_ptr<Vfs::File> file) : Abstract(file) {
+        chunkFrames = alignChunkSize(MP3_FRAME_SIZE);
+    };
     ~Mp3() { close(); };
 
     void open() override;
     void close() override;
     void probe() override;
     long decode(std::vector<int16_t>* buffer, size_t count, size_t offset) override;
+    Type type() const override { return Type::Mp3; };
+    void index() override;
 
     static size_t onRead(void* datasrc, void* ptr, size_t bytes);
     static drmp3_bool32 onSeek(void* datasrc, int offset, drmp3_seek_origin whence);
@@ -20,7 +27,11 @@ public:
     static void onMeta(void* datasrc, const drmp3_metadata* metadata);
 
 private:
+    void bindSeekTable();
+
     drmp3* decoder = nullptr;
+    std::vector<drmp3_seek_point> seekTable;
+    bool seekTableBound = false;
 };
 
 } // namespace Decoder
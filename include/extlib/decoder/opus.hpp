@@ -4,15 +4,22 @@
 
 namespace Decoder {
 
+// 20 ms at 48 kHz, the frame size nearly every encoder uses
+constexpr size_t OPUS_FRAME_SIZE = 960;
+
 class Opus : public Abstract {
 public:
-    Opus(std::shared_ptr<Vfs::File> file) : Abstract(file) {};
+    Opus(std::shared_ptr<Vfs::File> file) : Abstract(file) {
+        chunkFrames = alignChunkSize(OPUS_FRAME_SIZE);
+    };
     ~Opus() { close(); };
 
     void open() override;
     void close() override;
     void probe() override;
     long decode(std::vector<int16_t>* buffer, size_t count, size_t offset) override;
+    Type type() const override { return Type::Opus; };
+    void index() override;
 
     static int onRead(void* datasrc, unsigned char* ptr, int bytes);
     static int onSeek(void* datasrc, opus_int64 offset, int whence);
@@ -20,6 +27,9 @@ public:
     static opus_int64 onTell(void* datasrc);
 
 private:
+    void seek(size_t offset);
+    void skip(size_t frames);
+
     OggOpusFile* decoder = nullptr;
     int bitstream = 0;
 };
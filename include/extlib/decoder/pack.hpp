@@ -0,0 +1,54 @@
+#pragma once
+#include <extlib/decoder/abstract.hpp>
+
+namespace Decoder {
+
+// Native PCM pack: already decoded audio, one big-endian s16 plane per track. Planes start on
+// PACK_ALIGN byte boundaries so they can be mapped or DMA'd directly.
+//
+// Header, all fields big-endian:
+//   0x00  char[4]  "APCM"
+//   0x04  u32      version
+//   0x08  u32      trackCount
+//   0x0C  u32      sampleRate
+//   0x10  u32      sampleCount
+//   0x14  u32      loopStart
+//   0x18  u32      loopEnd
+//   0x1C  s32      loopCount
+//   0x20  u32      dataOffset, start of the first plane
+//   0x24  u32      planeStride, bytes from one plane to the next
+constexpr uint32_t PACK_VERSION = 1;
+constexpr size_t PACK_HEADER_SIZE = 64;
+constexpr size_t PACK_ALIGN = 4096;
+
+struct PackHeader {
+    uint32_t trackCount = 0;
+    uint32_t sampleRate = 0;
+    uint32_t sampleCount = 0;
+    uint32_t loopStart = 0;
+    uint32_t loopEnd = 0;
+    int32_t loopCount = 0;
+    uint32_t dataOffset = PACK_ALIGN;
+    uint32_t planeStride = 0;
+
+    bool parse(const uint8_t* data);
+    void serialize(uint8_t* data) const;
+};
+
+class Pack : public Abstract {
+public:
+    Pack(std::shared_ptr<Vfs::File> file) : Abstract(file) {};
+    ~Pack() { close(); };
+
+    void open() override;
+    void close() override;
+    void probe() override;
+    long decode(std::vector<int16_t>* buffer, size_t count, size_t offset) override;
+    Type type() const override { return Type::Pack; };
+
+private:
+    PackHeader header;
+    bool isOpen = false;
+};
+
+} // namespace Decoder
@@ -0,0 +1,44 @@
+#pragma once
+#include <extlib/decoder/abstract.hpp>
+#include <extlib/dsp/resampler.hpp>
+
+namespace Decoder {
+
+// Wraps another decoder and converts its output to a fixed sample rate. Metadata is reported at
+// the output rate, the wrapped decoder keeps its own at the source rate. Streams already at the
+// output rate, or at a ratio the resampler can't handle, pass through untouched.
+class Resampled : public Abstract {
+public:
+    Resampled(std::shared_ptr<Vfs::File> file, std::unique_ptr<Abstract> inner, uint32_t outputRate)
+        : Abstract(file), inner(std::move(inner)), outputRate(outputRate) {};
+    ~Resampled() { close(); };
+
+    void open() override;
+    void close() override;
+    void probe() override;
+    long decode(std::vector<int16_t>* buffer, size_t count, size_t offset) override;
+    Type type() const override { return inner->type(); };
+    void index() override { inner->index(); };
+    std::unique_ptr<Abstract> clone(std::shared_ptr<Vfs::File> file) override;
+
+private:
+    void setup();
+    void fill(int64_t start, int64_t end);
+
+    std::unique_ptr<Abstract> inner;
+    uint32_t outputRate;
+    Dsp::Resampler resampler;
+    bool configured = false;
+    bool passthrough = true;
+
+    // Source frames kept from the last call, so consecutive chunks share their overlap
+    // instead of seeking the wrapped decoder back
+    std::vector<int16_t> source;
+    int64_t sourceStart = 0;
+    size_t sourceFrames = 0;
+
+    std::vector<int16_t> scratch;
+    std::vector<float> plane;
+};
+
+} // namespace Decoder
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <extlib/vfs/file.hpp>
+
+namespace Decoder {
+
+struct SeekPoint {
+    uint64_t frame;                  // First PCM frame produced when decoding from offset
+    uint64_t offset;                 // Byte offset of the codec frame or page
+    uint16_t framesToDiscard = 0;    // Codec frames to decode and drop before frame is reached
+    uint16_t pcmFramesToDiscard = 0; // PCM frames to drop after that
+};
+
+// Whether target is reached sooner by decoding forward from current than by seeking. Up to about a
+// second of audio that holds, since an Ogg seek bisects the file. current is negative when the
+// library can't tell where it is.
+inline bool withinSkip(int64_t current, uint64_t target, uint64_t maxFrames) {
+    return current >= 0 && target >= static_cast<uint64_t>(current) && target - current <= maxFrames;
+}
+
+// Built once per stream, then shared read-only by every decoder instance reading that stream
+class SeekIndex {
+public:
+    void build(const std::function<std::vector<SeekPoint>()>& fn);
+
+    bool ready() const {
+        return isReady.load(std::memory_order_acquire);
+    }
+
+    const std::vector<SeekPoint>& points() const {
+        return seekPoints;
+    }
+
+    const SeekPoint* find(uint64_t frame) const;
+
+    static std::vector<SeekPoint> scanOgg(std::shared_ptr<Vfs::File> file, uint64_t granuleOffset);
+
+private:
+    std::vector<SeekPoint> seekPoints;
+    std::atomic<bool> isReady = false;
+    std::once_flag once;
+};
+
+} // namespace Decoder
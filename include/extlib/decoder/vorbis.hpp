@@ -13,6 +13,8 @@ public:
     void close() override;
     void probe() override;
     long decode(std::vector<int16_t>* buffer, size_t count, size_t offset) override;
+    Type type() const override { return Type::Vorbis; };
+    void index() override;
 
     static size_t onRead(void* ptr, size_t size, size_t nmemb, void* datasource);
     static int onSeek(void* datasrc, ogg_int64_t offset, int whence);
@@ -20,6 +22,9 @@ public:
     static long onTell(void* datasrc);
 
 private:
+    void seek(size_t offset);
+    void skip(size_t frames);
+
     OggVorbis_File* decoder = nullptr;
     int bitstream = 0;
 };
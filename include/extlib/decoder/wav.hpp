@@ -13,6 +13,7 @@ public:
     void close() override;
     void probe() override;
     long decode(std::vector<int16_t>* buffer, size_t count, size_t offset) override;
+    Type type() const override { return Type::Wav; };
 
     static size_t onRead(void* datasrc, void* ptr, size_t bytes);
     static drwav_bool32 onSeek(void* datasrc, int offset, drwav_seek_origin whence);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Dsp {
+
+enum class Isa {
+    Scalar,
+    Sse2,
+    Avx2,
+    Neon,
+};
+
+using DeinterleaveFn = void (*)(int16_t* plane, const int16_t* src, size_t frames, size_t trackNo);
+
+// Planes hold the samples of a single track in rdram order, meaning each pair of halfwords is
+// swapped. A plane must always be allocated with an even number of samples.
+inline size_t planeStride(size_t frames) {
+    return (frames + 1) & ~static_cast<size_t>(1);
+}
+
+Isa bestIsa();
+const char* isaName(Isa isa);
+DeinterleaveFn deinterleaveKernel(Isa isa, size_t trackCount);
+
+void deinterleave(int16_t* plane, const int16_t* src, size_t frames, size_t trackCount, size_t trackNo);
+void copyToRdram(uint8_t* rdram, int32_t ptr, const int16_t* plane, size_t start, size_t count);
+void fillRdram(uint8_t* rdram, int32_t ptr, int16_t value, size_t count);
+
+} // namespace Dsp
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Dsp {
+
+// Converts between two fixed sample rates with a polyphase filter. The ratio is reduced to up / down,
+// and each output frame is the dot product of TAPS input frames with one phase of a Kaiser windowed
+// sinc, chosen by where the frame falls between two input frames.
+class Resampler {
+public:
+    static constexpr size_t TAPS = 32;
+    static constexpr uint32_t MAX_PHASES = 2048;
+
+    // Returns false if the ratio does not reduce to MAX_PHASES phases or less
+    bool init(uint32_t inputRate, uint32_t outputRate);
+
+    // Input frames read by output frames [outputFrame, outputFrame + frames), end is exclusive
+    int64_t windowStart(uint64_t outputFrame) const;
+    int64_t windowEnd(uint64_t outputFrame, size_t frames) const;
+
+    // Number of output frames for a stream of inputFrames, and where an input frame ends up
+    uint64_t outputLength(uint64_t inputFrames) const;
+    uint64_t outputFrame(uint64_t inputFrame) const;
+
+    // Writes frames samples to out, stride apart. input holds a single track as floats, starting
+    // at input frame inputStart, and must cover the window of the requested output frames.
+    void process(int16_t* out, size_t stride, const float* input, int64_t inputStart,
+                 uint64_t outputFrame, size_t frames) const;
+
+private:
+    uint32_t up = 1;
+    uint32_t down = 1;
+    std::vector<float> coeffs;
+};
+
+} // namespace Dsp
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Dsp {
+
+// N64 VADPCM, the format the RSP decodes natively. Each frame packs 16 samples into a header byte,
+// holding a scale and which predictor to use, followed by 16 signed 4-bit residuals.
+constexpr size_t VADPCM_FRAME_SAMPLES = 16;
+constexpr size_t VADPCM_FRAME_BYTES = 9;
+
+inline size_t vadpcmFrames(size_t samples) {
+    return (samples + VADPCM_FRAME_SAMPLES - 1) / VADPCM_FRAME_SAMPLES;
+}
+
+// Second order predictors, expanded over the 8 samples decoded at a time in 5.11 fixed point, the
+// layout of an AdpcmBook's codeBook. Predictor 0 is always silence, for frames nothing predicts well.
+struct VadpcmBook {
+    static constexpr size_t ORDER = 2;
+    static constexpr size_t PREDICTORS = 4;
+
+    int16_t table[PREDICTORS][ORDER][8];
+};
+
+// Fits a codebook to some audio. Each frame is assigned to whichever predictor suits it best, then
+// the predictors are refit to the frames assigned to them, a few times over.
+class VadpcmDesigner {
+public:
+    // Adds count samples of one track, stride apart
+    void add(const int16_t* samples, size_t count, size_t stride);
+    VadpcmBook design() const;
+
+private:
+    // Sums over a frame for predicting each sample from the two before it
+    struct FrameStats {
+        double r11, r12, r22;
+        double x1, x2;
+        double xx;
+    };
+
+    std::vector<FrameStats> frames;
+};
+
+// Both keep history as the last two decoded samples, oldest first, and leave it updated for the next
+// frame. The encoder picks the predictor and scale that reproduce the frame most closely, and can also
+// return what the RSP will decode from it.
+void encodeVadpcmFrame(const VadpcmBook& book, const int16_t* in, int16_t* history, uint8_t* out,
+                       int16_t* decoded = nullptr);
+void decodeVadpcmFrame(const VadpcmBook& book, const uint8_t* in, int16_t* history, int16_t* out);
+
+// Encodes frames samples of trackNo into a plane stored in rdram byte order, padding the last frame
+// with silence. history holds the two samples before the first frame.
+void encodeVadpcmPlane(uint8_t* plane, const VadpcmBook& book, const int16_t* src, size_t frames,
+                       size_t trackCount, size_t trackNo, const int16_t* history);
+
+// Byte counterpart of copyToRdram, for planes stored in rdram byte order
+void copyBytesToRdram(uint8_t* rdram, int32_t ptr, const uint8_t* plane, size_t start, size_t count);
+
+} // namespace Dsp
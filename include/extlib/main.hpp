@@ -1,12 +1,12 @@
 #pragma once
 #include <cstddef>
-#include <memory>
-#include <shared_mutex>
-#include <unordered_map>
 
-#include <extlib/resource/abstract.hpp>
+#include <extlib/cache/manager.hpp>
+#include <extlib/cache/probeindex.hpp>
+#include <extlib/resource/registry.hpp>
 #include <extlib/vfs/filesystem.hpp>
 
 extern Vfs::Filesystem gVfs;
-extern std::unordered_map<size_t, std::shared_ptr<Resource::Abstract>> gResourceData;
-extern std::shared_mutex gResourceDataMutex;
+extern Cache::Manager gCacheManager;
+extern Cache::ProbeIndex gProbeIndex;
+extern Resource::Registry gResources;
@@ -1,11 +1,15 @@
 #pragma once
 
-#include <any>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <memory>
-#include <vector>
 
 #include <audio_api/types.h>
 
+#include <extlib/stats.hpp>
+
 namespace Resource {
 
 enum class CacheStrategy {
@@ -14,6 +18,7 @@ enum class CacheStrategy {
     Preload             = AUDIOAPI_CACHE_PRELOAD,
     PreloadOnUse        = AUDIOAPI_CACHE_PRELOAD_ON_USE,
     PreloadOnUseNoEvict = AUDIOAPI_CACHE_PRELOAD_ON_USE_NO_EVICT,
+    PreloadOnUseNoBlock = AUDIOAPI_CACHE_PRELOAD_ON_USE_NO_BLOCK,
 };
 
 inline CacheStrategy parseCacheStrategy(uint32_t val) {
@@ -24,24 +29,107 @@ inline CacheStrategy parseCacheStrategy(uint32_t val) {
     case CacheStrategy::Preload:
     case CacheStrategy::PreloadOnUse:
     case CacheStrategy::PreloadOnUseNoEvict:
+    case CacheStrategy::PreloadOnUseNoBlock:
         return cacheStrategy;
     default:
         return CacheStrategy::Default;
     }
 }
 
+using Deadline = std::chrono::steady_clock::time_point;
+
+enum class PreloadKind : uint8_t {
+    // Brings the whole resource into cache, as far as its cache strategy asks for
+    Full,
+    // Loads the chunk starting at offset
+    Chunk,
+};
+
+// Tasks run earliest deadline first, and a default constructed deadline means as soon as possible
 struct PreloadTask {
-    int priority;
-    std::any data;
+    Deadline deadline;
+    PreloadKind kind = PreloadKind::Full;
+    size_t offset = 0;
+};
+
+// Pending preload tasks of one resource, earliest deadline on top. Storage is fixed, so keeping it
+// up to date as playback moves on never allocates.
+class PreloadHeap {
+public:
+    static constexpr size_t CAPACITY = 64;
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    const PreloadTask& top() const {
+        return tasks[0];
+    }
+
+    // False if the heap is full
+    bool push(const PreloadTask& task) {
+        if (count == CAPACITY) {
+            return false;
+        }
+        tasks[count++] = task;
+        std::push_heap(tasks.begin(), tasks.begin() + count, later);
+        return true;
+    }
+
+    PreloadTask pop() {
+        std::pop_heap(tasks.begin(), tasks.begin() + count, later);
+        return tasks[--count];
+    }
+
+    void clear() {
+        count = 0;
+    }
+
+private:
+    static bool later(const PreloadTask& a, const PreloadTask& b) {
+        return a.deadline > b.deadline;
+    }
+
+    std::array<PreloadTask, CAPACITY> tasks;
+    size_t count = 0;
 };
 
 class Abstract {
 public:
     virtual void dma(uint8_t* rdram, int32_t ptr, size_t offset, size_t count, uint32_t arg1, uint32_t arg2) = 0;
-    virtual std::vector<PreloadTask> getPreloadTasks() = 0;
+    // Brings preloadTasks up to date with what should be loaded next. Both this and runPreloadTask
+    // are only called by whoever set preloadRunning.
+    virtual void updatePreloadTasks() = 0;
     virtual void runPreloadTask(const PreloadTask& task) = 0;
     virtual void gc() = 0;
 
+    // Bytes currently held in cache, and a request to drop at least the given amount of them
+    virtual size_t cacheSize() = 0;
+    virtual size_t evict(size_t bytes) = 0;
+
+    // Relative cost of refilling the cache, used to weight eviction
+    virtual int evictionWeight() const {
+        return 1;
+    }
+
+    void touch() {
+        clockCredit.store(evictionWeight(), std::memory_order_relaxed);
+    }
+
+    std::atomic<int> clockCredit = 0;
+
+    // Set while the scheduler or a decode worker owns this resource's preload tasks
+    std::atomic<bool> preloadRunning = false;
+    PreloadHeap preloadTasks;
+
+    // Set while this resource waits in the preload request queue, so it is only queued once
+    std::atomic<bool> preloadQueued = false;
+
+    // DMA requests that could not be served from cache and were filled in without waiting
+    std::atomic<uint32_t> underruns = 0;
+
+    Stats::Counters stats;
+
 protected:
     bool initialPreload = true;
 };
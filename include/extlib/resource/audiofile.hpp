@@ -2,12 +2,19 @@
 
 #include <atomic>
 #include <chrono>
-#include <map>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <vector>
 
+#include <extlib/cache/chunkpool.hpp>
+#include <extlib/cache/chunktable.hpp>
+#include <extlib/cache/coldstore.hpp>
+#include <extlib/cache/diskcache.hpp>
+#include <extlib/cache/probeindex.hpp>
 #include <extlib/decoder/abstract.hpp>
+#include <extlib/dsp/vadpcm.hpp>
 #include <extlib/resource/abstract.hpp>
 #include <extlib/utils.hpp>
 #include <extlib/vfs/file.hpp>
@@ -18,33 +25,128 @@ class Audiofile : public Abstract {
 public:
     Audiofile() = delete;
     Audiofile(std::shared_ptr<Vfs::File> file, Decoder::Type type = Decoder::Type::Auto,
+              CacheStrategy cacheStrategy = CacheStrategy::Default, uint32_t resampleRate = 0);
+    Audiofile(std::shared_ptr<Vfs::File> file, const Cache::ProbeEntry& probe,
               CacheStrategy cacheStrategy = CacheStrategy::Default);
     ~Audiofile();
 
     void open();
     void close();
     void probe();
+    Cache::ProbeEntry probeEntry() const;
+    void enableVadpcm();
+    void prepareVadpcm();
 
-    std::shared_ptr<std::vector<int16_t>> getChunk(size_t offset);
+    bool isVadpcm() const { return vadpcm; }
+    const Dsp::VadpcmBook& vadpcmBook() const { return book; }
+    const int16_t* vadpcmLoopState(uint32_t trackNo) const {
+        return loopStates.data() + trackNo * Dsp::VADPCM_FRAME_SAMPLES;
+    }
+
+    bool hasChunk(size_t offset);
+    void loadChunk(size_t offset, bool preload, uint32_t trackNo = 0,
+                   const std::function<void(const int16_t*)>& fn = {});
 
     void dma(uint8_t* rdram, int32_t ptr, size_t offset, size_t count, uint32_t trackNo, uint32_t arg2) override;
-    std::vector<PreloadTask> getPreloadTasks() override;
+    void updatePreloadTasks() override;
     void runPreloadTask(const PreloadTask& task) override;
     void gc() override;
+    size_t cacheSize() override;
+    size_t evict(size_t bytes) override;
+    int evictionWeight() const override;
 
     std::shared_ptr<Decoder::Metadata> metadata;
 
+    static std::atomic<bool> splitDecoders;
+    static std::atomic<uint32_t> resampleRate;
+    static std::atomic<uint32_t> streamFormat;
+    static std::atomic<bool> compressCache;
+
 private:
+    Decoder::Abstract* getDecoder();
+    Decoder::Abstract* openDecoder(bool preload);
+    Deadline chunkDeadline(size_t offset) const;
+    bool extendPreloadWindow(size_t chunks);
+    void resetPreloadWindow(size_t start);
+    void prunePreloadTasks();
+    bool preloadWanted(size_t offset);
+
+    const std::vector<int16_t>& decodeChunk(size_t offset, bool preload, size_t& framesRead);
+    void compressChunk(size_t offset);
+    bool promoteChunk(uint32_t chunkNo, uint64_t mask);
+    bool usesColdTier() const;
+
+    std::vector<int16_t> chunkHistory(uint32_t chunkNo, bool preload);
+    void storeChunkTail(uint32_t chunkNo, const std::vector<int16_t>& interleaved, size_t framesRead);
+    void loadEncodedChunk(size_t offset, bool preload, uint32_t trackNo, uint64_t mask,
+                          const std::function<void(const int16_t*)>& fn);
+    void dmaEncoded(uint8_t* rdram, int32_t ptr, size_t offset, size_t count, uint32_t trackNo);
+
+    void setChunkSize(size_t frames);
+    void buildSeekIndex(Decoder::Abstract* decoder);
+    void attachDiskCache();
+    size_t chunkStart(size_t offset) const;
+    size_t chunkEnd(size_t offset) const;
+    size_t nextChunk(size_t offset) const;
+    size_t numChunks() const;
+    size_t chunkDistance(size_t curChunk, size_t thisChunk) const;
+    uint64_t trackMask() const;
+    bool isTrackCached(uint64_t mask, uint32_t trackNo) const;
+    uint32_t planeKey(uint32_t chunkNo, uint32_t trackNo) const;
+    const int16_t* findPlane(size_t offset, uint32_t trackNo);
+    void dropPlane(uint32_t key);
+
     std::shared_ptr<Vfs::File> file;
     std::unique_ptr<Decoder::Abstract> decoder;
+    std::once_flag decoderOnce;
+    std::atomic<bool> hasDecoder = false;
+    std::atomic<Decoder::Type> codec;
+    uint32_t outputRate;
+    std::shared_ptr<Vfs::File> preloadFile;
+    std::unique_ptr<Decoder::Abstract> preloadDecoder;
+    // Held while the preload decoder is created, read through or closed, since gc closes it from
+    // another thread
+    std::mutex preloadDecoderMutex;
 
-    size_t numChunks = 0;
+    size_t chunkSize;
+    size_t planeStride;
     std::atomic<size_t> pos = 0;
     std::atomic<std::chrono::steady_clock::time_point> atime{EPOCH};
+    std::atomic<std::chrono::steady_clock::time_point> dmaTime{EPOCH};
+
+    // Tracks dma asked for since the last gc, and during the gc interval before that. Only planes
+    // of these tracks stay in memory, until the first request every track is cached.
+    std::atomic<uint64_t> requestedTracks = 0;
+    std::atomic<uint64_t> activeTracks = 0;
+
+    // Chunks that preloadTasks was filled in for, from the one played at preloadStart up to
+    // preloadEnd, following loops. Anything that could have emptied a chunk in between, like a
+    // change of tracks or a plane dropped by gc or an eviction, makes the next update start over.
+    bool preloadWindow = false;
+    size_t preloadStart = 0;
+    size_t preloadEnd = 0;
+    uint64_t preloadMask = 0;
+    uint64_t preloadGeneration = 0;
+    // Bumped under cacheMutex whenever a plane leaves the cache
+    std::atomic<uint64_t> dropGeneration = 0;
 
     CacheStrategy cacheStrategy;
-    std::map<size_t, std::shared_ptr<std::vector<int16_t>>> cache;
+    Cache::ChunkTable table;
+    Cache::ChunkPool pool;
+    Cache::ColdStore cold;
+    std::unique_ptr<Cache::DiskCache> diskCache;
     std::shared_mutex cacheMutex;
+
+    // Streamed as VADPCM instead of PCM, fixed before the file is registered. The pool then holds
+    // encoded planes, addressed by byte. Encoding a chunk needs the last two samples of the one
+    // before it, which are kept for every chunk decoded so far.
+    bool vadpcm = false;
+    std::once_flag vadpcmOnce;
+    Dsp::VadpcmBook book;
+    std::vector<int16_t> loopStates;
+    size_t encodedStride = 0;
+    std::vector<int16_t> chunkTails;
+    std::vector<bool> chunkTailKnown;
 };
 
 } // namespace Resource
@@ -29,9 +29,11 @@ public:
     };
 
     void dma(uint8_t* rdram, int32_t ptr, size_t offset, size_t size, uint32_t arg1, uint32_t arg2) override;
-    std::vector<PreloadTask> getPreloadTasks() override;
+    void updatePreloadTasks() override;
     void runPreloadTask(const PreloadTask& task) override;
     void gc() override;
+    size_t cacheSize() override;
+    size_t evict(size_t bytes) override;
 
 protected:
     std::shared_ptr<Vfs::File> file;
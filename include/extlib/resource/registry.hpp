@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include <extlib/resource/abstract.hpp>
+
+namespace Resource {
+
+// Every registered resource by id. Ids are handed out densely from 0 and resources are never
+// removed, so the registry is an append-only array split into segments that double in size. A
+// lookup is two loads and never waits, however many mods are registering files at the same time.
+class Registry {
+public:
+    Registry() = default;
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    // Returns the new resource's id, which it can be found by as soon as this returns
+    size_t add(ResourcePtr resource);
+
+    // Resources live as long as the process, so the raw pointer stays valid. nullptr for unknown ids.
+    Abstract* find(size_t id) const;
+    ResourcePtr get(size_t id) const;
+
+    // Ids handed out so far, some of which may still be on their way in
+    size_t size() const {
+        return next.load(std::memory_order_acquire);
+    }
+
+    // Visits the resources in id order
+    template <typename F>
+    void forEach(F&& fn) const {
+        size_t count = size();
+        for (size_t id = 0; id < count; id++) {
+            if (const Slot* slot = locate(id); slot && slot->ready.load(std::memory_order_acquire)) {
+                fn(id, slot->resource);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t FIRST_SEGMENT_BITS = 6;
+    static constexpr size_t SEGMENTS = 26;
+
+    // The resource is written once, before ready is set, and never changes after
+    struct Slot {
+        ResourcePtr resource;
+        std::atomic<bool> ready = false;
+    };
+
+    static size_t segmentOf(size_t id);
+    static size_t segmentSize(size_t segment);
+    static size_t indexIn(size_t id, size_t segment);
+
+    const Slot* locate(size_t id) const;
+
+    // Segments are never freed, the registry lives as long as the process and readers never lock
+    std::array<std::atomic<Slot*>, SEGMENTS> segments = {};
+    std::atomic<size_t> next = 0;
+};
+
+} // namespace Resource
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <audio_api/types.h>
+
+namespace Stats {
+
+constexpr size_t CODECS = AUDIOAPI_CODEC_PCM_PACK + 1;
+
+// Kept by every resource. Only ever added to with relaxed atomics, so the audio thread never waits
+// on them, and readers may see one counter a little ahead of another.
+struct Counters {
+    std::atomic<uint64_t> dmaCalls = 0;
+    std::atomic<uint64_t> bytesServed = 0;
+    std::atomic<uint64_t> chunkHits = 0;
+    std::atomic<uint64_t> chunkMisses = 0;
+    std::atomic<uint64_t> mainThreadDecodeNs = 0;
+    std::atomic<uint64_t> evictions = 0;
+    std::atomic<uint64_t> evictedBytes = 0;
+};
+
+// Process wide, for what doesn't belong to a single resource
+struct Global {
+    std::atomic<uint64_t> decodeNs[CODECS] = {};
+    std::atomic<uint64_t> decodeFrames[CODECS] = {};
+    std::atomic<size_t> queueDepth = 0;
+    std::atomic<size_t> queueDepthMax = 0;
+};
+
+extern Global gStats;
+
+inline void add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+// A decode of frames by the codec with the given AudioApiCodec value, on any thread
+void recordDecode(uint32_t codec, size_t frames, std::chrono::nanoseconds elapsed);
+void recordQueueDepth(size_t depth);
+
+// Totals of one resource, or of all of them for a negative resourceId. Queue depth and decode times
+// per codec are always process wide.
+struct Snapshot {
+    uint64_t dmaCalls = 0;
+    uint64_t bytesServed = 0;
+    uint64_t chunkHits = 0;
+    uint64_t chunkMisses = 0;
+    uint64_t underruns = 0;
+    uint64_t mainThreadDecodeNs = 0;
+    uint64_t evictions = 0;
+    uint64_t evictedBytes = 0;
+    uint64_t cacheBytes = 0;
+    uint64_t queueDepth = 0;
+    uint64_t queueDepthMax = 0;
+    uint64_t decodeNs[CODECS] = {};
+    uint64_t decodeFrames[CODECS] = {};
+};
+
+Snapshot collect(int64_t resourceId);
+void toAudioApiStats(const Snapshot& snapshot, AudioApiStats* out);
+
+// Logs what changed since the last summary, at most once per interval and only while audio plays
+void logSummary();
+
+} // namespace Stats
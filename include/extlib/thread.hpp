@@ -1,10 +1,18 @@
 #pragma once
+#include <chrono>
 #include <cstddef>
+#include <functional>
 #include <thread>
 
 extern std::thread::id gMainThreadId;
 extern std::thread::id gWorkerThreadId;
 
 void workerThreadNotify();
+void workerThreadTick();
+void preemptPreload(std::chrono::steady_clock::time_point deadline);
+std::chrono::nanoseconds tickInterval();
 void workerThreadLoop();
+void workerPoolStart();
+void setWorkerCount(size_t count);
 void queuePreload(size_t resourceId);
+void parallelFor(size_t count, const std::function<void(size_t)>& fn);
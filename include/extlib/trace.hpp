@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// Opt-in timeline of what the audio thread and the workers spend their time on, written as Chrome
+// trace event JSON for chrome://tracing or Perfetto. Spans go into a fixed ring buffer, so a long
+// session keeps its most recent events, and costs a single relaxed load per span while stopped.
+namespace Trace {
+
+extern std::atomic<bool> enabled;
+
+// Clears the buffer and starts recording. The calling thread is named "main" in the trace.
+void start();
+
+// Stops recording and writes the trace to the output path. Writing also works while recording, and
+// both return false if the file could not be written.
+bool stop();
+bool write(const fs::path& path);
+
+void setOutputPath(fs::path path);
+
+// Names the calling thread in the trace
+void setThreadName(std::string name);
+
+void record(const char* name, uint64_t start, uint64_t end, uint64_t arg);
+uint64_t now();
+
+// Records the span from construction to destruction, if tracing was on when it began. name must be
+// a string literal, and arg shows up with it, like a resource id or a sample offset.
+class Span {
+public:
+    explicit Span(const char* name, uint64_t arg = 0)
+        : name(name), arg(arg), start(enabled.load(std::memory_order_relaxed) ? now() : 0) {}
+
+    ~Span() {
+        if (start != 0) {
+            record(name, start, now(), arg);
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* name;
+    uint64_t arg;
+    uint64_t start;
+};
+
+} // namespace Trace
@@ -18,6 +18,12 @@ public:
     virtual int64_t seek(int64_t offset, int whence) = 0;
     virtual int64_t tell() = 0;
 
+    // Returns a separate handle to the same file, with its own position
+    virtual std::shared_ptr<File> clone() const = 0;
+
+    // Changes whenever the contents change, without having to read them
+    virtual uint64_t fingerprint() const = 0;
+
     size_t size() const {
         return filesize;
     };
@@ -20,6 +20,8 @@ public:
     size_t read(void* buffer, size_t bytes) override;
     int64_t seek(int64_t offset, int whence) override;
     int64_t tell() override;
+    std::shared_ptr<File> clone() const override;
+    uint64_t fingerprint() const override;
 
 private:
     std::ifstream stream;
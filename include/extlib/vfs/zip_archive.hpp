@@ -24,6 +24,7 @@ public:
         size_t size;
         size_t offset = 0;
         bool compressed = true;
+        uint32_t crc32 = 0;
     };
 
     void init();
@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <mutex>
 
 #include <extlib/vfs/file.hpp>
 #include <extlib/vfs/zip_archive.hpp>
@@ -23,12 +24,22 @@ public:
     size_t read(void* buffer, size_t bytes) override;
     int64_t seek(int64_t offset, int whence) override;
     int64_t tell() override;
+    std::shared_ptr<File> clone() const override;
+    uint64_t fingerprint() const override;
 
 private:
+    // A compressed entry is inflated once for a file and all its clones, and freed when the last
+    // of them closes
+    struct Inflated {
+        std::mutex mutex;
+        std::weak_ptr<const std::vector<uint8_t>> buffer;
+    };
+
     ZipArchive::FileInfo info;
 
     size_t curPos = 0;
-    std::vector<uint8_t> buffer;
+    std::shared_ptr<const std::vector<uint8_t>> buffer;
+    std::shared_ptr<Inflated> inflated = std::make_shared<Inflated>();
     std::shared_ptr<ZipArchive> archive;
 };
 
@@ -291,6 +291,31 @@ RECOMP_PATCH s32 AudioLoad_Dma(OSIoMesg* mesg, u32 priority, s32 direction, uint
     return AudioApi_Dma_Rom(mesg, priority, direction, devAddr, ramAddr, size, reqQueue, medium, dmaFuncType);
 }
 
+// Compressed samples streamed through a callback are addressed by byte offset instead of by sample.
+// The RSP loads from a 16 byte boundary, so the data is fetched from one, and the returned pointer
+// keeps the same alignment as the requested offset.
+void* AudioApi_DmaCallbackData(uintptr_t devAddr, size_t size, size_t offset) {
+    size_t alignedOffset = offset & ~0xF;
+    size_t dmaSize = ALIGN16(size + (offset - alignedOffset));
+    u8* ramAddr;
+    s32 result;
+
+    ramAddr = AudioApi_RspCacheOffsetSearch((void*)devAddr, dmaSize, alignedOffset);
+    if (ramAddr) {
+        return ramAddr + (offset - alignedOffset);
+    }
+    ramAddr = AudioApi_RspCacheAlloc((void*)devAddr, dmaSize, alignedOffset);
+    if (!ramAddr) {
+        return NULL;
+    }
+    result = AudioApi_Dma_Callback(devAddr, ramAddr, dmaSize, alignedOffset);
+    if (result != 0) {
+        AudioApi_RspCacheInvalidateLastEntry();
+        return NULL;
+    }
+    return ramAddr + (offset - alignedOffset);
+}
+
 RECOMP_PATCH void* AudioLoad_DmaSampleData(uintptr_t devAddr, size_t size, s32 arg2, u8* dmaIndexRef, s32 medium) {
     uintptr_t dmaDevAddr;
     size_t dmaSize;
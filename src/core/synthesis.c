@@ -617,6 +617,12 @@ RECOMP_PATCH Acmd* AudioSynth_ProcessSample(s32 noteIndex, NoteSampleState* samp
                     } else if (sample->medium == MEDIUM_UNK) {
                         // This medium is unsupported so terminate processing this note
                         return cmd;
+                    } else if (IS_DMA_CALLBACK_DEV_ADDR(sampleAddr)) {
+                        // @mod add support for streamed ADPCM, which is fetched by offset from the callback
+                        samplesToLoadAddr =
+                            AudioApi_DmaCallbackData((uintptr_t)sampleAddr,
+                                                     ALIGN16((numFramesToDecode * frameSize) + SAMPLES_PER_FRAME),
+                                                     zeroOffset + sampleAddrOffset);
                     } else {
                         // This medium is not in ram, so dma the requested sample into ram
                         samplesToLoadAddr =
@@ -0,0 +1,320 @@
+// Measures each decoder through the real file backends, to pick cache strategies per codec from data.
+// For every input, backend and chunk size it times:
+//   open      creating, opening, probing and indexing a decoder from scratch
+//   decode    reading the whole file front to back, one chunk at a time
+//   seek      decoding a chunk at a random position
+//   wrap      decoding the chunk at the loop start right after the one at the loop end
+//
+// usage: bench_decoders [--chunks 256,1024,4096] [--seeks N] [inputs...]
+//
+// Inputs are files, or entries of an existing archive written as archive.zip:path/in/archive. Files
+// are also copied into an uncompressed zip, so each is measured through both NativeFile and ZipFile.
+// Without inputs, WAVs with 1, 2, 4 and 8 channels are synthesized. Results are printed as CSV.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <extlib/decoder/abstract.hpp>
+#include <extlib/vfs/native_file.hpp>
+#include <extlib/vfs/zip_archive.hpp>
+#include <extlib/vfs/zip_file.hpp>
+
+#include "synth.hpp"
+
+constexpr size_t OPEN_REPEATS = 5;
+constexpr size_t WRAP_REPEATS = 20;
+constexpr size_t DEFAULT_SEEKS = 200;
+
+constexpr uint32_t SYNTH_SAMPLE_RATE = 44100;
+constexpr uint32_t SYNTH_SECONDS = 30;
+
+struct Input {
+    std::string name;
+    std::string backend;
+    std::function<std::shared_ptr<Vfs::File>()> open;
+};
+
+struct Result {
+    double openUs;
+    double decodeNsPerFrame;
+    double realtime;
+    double chunkUs;
+    double seekP50Us;
+    double seekP99Us;
+    double wrapUs;
+};
+
+static const char* typeName(Decoder::Type type) {
+    switch (type) {
+    case Decoder::Type::Wav:    return "wav";
+    case Decoder::Type::Flac:   return "flac";
+    case Decoder::Type::Mp3:    return "mp3";
+    case Decoder::Type::Vorbis: return "vorbis";
+    case Decoder::Type::Opus:   return "opus";
+    case Decoder::Type::Pack:   return "pack";
+    default:                    return "auto";
+    }
+}
+
+template <typename F>
+static double timeUs(F&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(p / 100.0 * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+// Only what ZipArchive needs to find the entries: stored entries, a central directory and its end
+// record, without timestamps or extra fields
+static void writeStoredZip(const fs::path& path, const std::vector<std::pair<std::string, fs::path>>& entries) {
+    uint32_t table[256];
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    std::string central;
+
+    auto u16 = [](std::string& s, uint16_t v) { s.append(reinterpret_cast<const char*>(&v), 2); };
+    auto u32 = [](std::string& s, uint32_t v) { s.append(reinterpret_cast<const char*>(&v), 4); };
+
+    for (const auto& [ name, source ] : entries) {
+        std::ifstream in(source, std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        uint32_t crc = 0xFFFFFFFF;
+        for (unsigned char c : data) {
+            crc = table[(crc ^ c) & 0xFF] ^ (crc >> 8);
+        }
+        crc ^= 0xFFFFFFFF;
+
+        uint32_t offset = static_cast<uint32_t>(out.tellp());
+        uint32_t size = static_cast<uint32_t>(data.size());
+
+        std::string local;
+        u32(local, 0x04034b50); u16(local, 20); u16(local, 0); u16(local, 0);
+        u16(local, 0); u16(local, 0x21); u32(local, crc); u32(local, size); u32(local, size);
+        u16(local, static_cast<uint16_t>(name.size())); u16(local, 0);
+        local += name;
+        out.write(local.data(), local.size());
+        out.write(data.data(), data.size());
+
+        u32(central, 0x02014b50); u16(central, 20); u16(central, 20); u16(central, 0); u16(central, 0);
+        u16(central, 0); u16(central, 0x21); u32(central, crc); u32(central, size); u32(central, size);
+        u16(central, static_cast<uint16_t>(name.size())); u16(central, 0); u16(central, 0);
+        u16(central, 0); u16(central, 0); u32(central, 0); u32(central, offset);
+        central += name;
+    }
+
+    uint32_t centralOffset = static_cast<uint32_t>(out.tellp());
+    std::string end;
+    u32(end, 0x06054b50); u16(end, 0); u16(end, 0);
+    u16(end, static_cast<uint16_t>(entries.size())); u16(end, static_cast<uint16_t>(entries.size()));
+    u32(end, static_cast<uint32_t>(central.size())); u32(end, centralOffset); u16(end, 0);
+
+    out.write(central.data(), central.size());
+    out.write(end.data(), end.size());
+}
+
+static std::unique_ptr<Decoder::Abstract> openDecoder(const Input& input) {
+    auto file = input.open();
+    auto decoder = Decoder::factory(file);
+
+    file->open();
+    decoder->open();
+    decoder->probe();
+
+    // Seeks still work without an index, as they do in Resource::Audiofile
+    try {
+        decoder->index();
+    } catch (const std::runtime_error&) {
+    }
+
+    return decoder;
+}
+
+static Result measure(const Input& input, size_t chunk, size_t seeks, std::mt19937& rng) {
+    Result result{};
+
+    std::vector<double> opens;
+    for (size_t i = 0; i < OPEN_REPEATS; i++) {
+        opens.push_back(timeUs([&]() {
+            openDecoder(input)->close();
+        }));
+    }
+    result.openUs = percentile(opens, 50);
+
+    auto decoder = openDecoder(input);
+    const auto& metadata = *decoder->metadata;
+    size_t frames = metadata.sampleCount;
+    size_t chunks = (frames + chunk - 1) / chunk;
+    std::vector<int16_t> buffer(chunk * metadata.trackCount);
+
+    auto decodeAt = [&](size_t offset) {
+        decoder->decode(&buffer, std::min(chunk, frames - offset), offset);
+    };
+
+    double total = timeUs([&]() {
+        for (size_t offset = 0; offset < frames; offset += chunk) {
+            decodeAt(offset);
+        }
+    });
+
+    result.decodeNsPerFrame = total * 1000.0 / frames;
+    result.realtime = (static_cast<double>(frames) / metadata.sampleRate) / (total / 1e6);
+    result.chunkUs = total / chunks;
+
+    std::uniform_int_distribution<size_t> pick(0, chunks - 1);
+    std::vector<double> seekTimes;
+    for (size_t i = 0; i < seeks; i++) {
+        size_t offset = pick(rng) * chunk;
+        seekTimes.push_back(timeUs([&]() { decodeAt(offset); }));
+    }
+    result.seekP50Us = percentile(seekTimes, 50);
+    result.seekP99Us = percentile(seekTimes, 99);
+
+    // Files without loop points loop the whole file
+    size_t loopStart = metadata.loopStart;
+    size_t loopEnd = metadata.loopEnd > loopStart && metadata.loopEnd <= frames ? metadata.loopEnd : frames;
+    size_t lastChunk = loopEnd > chunk ? loopEnd - chunk : 0;
+
+    std::vector<double> wraps;
+    for (size_t i = 0; i < WRAP_REPEATS; i++) {
+        decodeAt(lastChunk);
+        wraps.push_back(timeUs([&]() { decodeAt(loopStart); }));
+    }
+    result.wrapUs = percentile(wraps, 50);
+
+    decoder->close();
+    return result;
+}
+
+static std::vector<size_t> parseChunks(const std::string& list) {
+    std::vector<size_t> chunks;
+    std::stringstream stream(list);
+    std::string item;
+
+    while (std::getline(stream, item, ',')) {
+        chunks.push_back(std::clamp<size_t>(std::stoul(item), 16, Decoder::MAX_CHUNK_SIZE));
+    }
+
+    return chunks;
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> chunks = { 256, Decoder::DEFAULT_CHUNK_SIZE, 4096 };
+    size_t seeks = DEFAULT_SEEKS;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--chunks" && i + 1 < argc) {
+            chunks = parseChunks(argv[++i]);
+        } else if (arg == "--seeks" && i + 1 < argc) {
+            seeks = std::stoul(argv[++i]);
+        } else if (arg.starts_with("--")) {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return 1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty()) {
+        for (uint32_t channels : { 1, 2, 4, 8 }) {
+            args.push_back(writeSyntheticWav(SYNTH_SAMPLE_RATE, channels, SYNTH_SECONDS).string());
+        }
+    }
+
+    std::vector<Input> inputs;
+    std::vector<std::pair<std::string, fs::path>> zipEntries;
+
+    for (const auto& arg : args) {
+        size_t split = arg.rfind(".zip:");
+
+        if (split != std::string::npos) {
+            fs::path archivePath = arg.substr(0, split + 4);
+            std::string entry = arg.substr(split + 5);
+            inputs.push_back({ entry, "zip", [=]() {
+                return std::make_shared<Vfs::ZipFile>(Vfs::ZipArchive::factory(archivePath), entry);
+            } });
+            continue;
+        }
+
+        fs::path path = arg;
+        std::string entry = std::to_string(zipEntries.size()) + "_" + path.filename().string();
+        zipEntries.emplace_back(entry, path);
+
+        inputs.push_back({ path.filename().string(), "native", [=]() {
+            return std::make_shared<Vfs::NativeFile>(path);
+        } });
+    }
+
+    if (!zipEntries.empty()) {
+        fs::path zipPath = fs::temp_directory_path() / "audioapi_bench_stored.zip";
+        writeStoredZip(zipPath, zipEntries);
+
+        for (const auto& [ entry, path ] : zipEntries) {
+            inputs.push_back({ path.filename().string(), "zip-stored", [=]() {
+                return std::make_shared<Vfs::ZipFile>(Vfs::ZipArchive::factory(zipPath), entry);
+            } });
+        }
+    }
+
+    std::mt19937 rng(1);
+
+    std::printf("file,backend,codec,tracks,sample_rate,frames,chunk,open_us,decode_ns_per_frame,"
+                "realtime,chunk_us,seek_p50_us,seek_p99_us,wrap_us\n");
+
+    for (const auto& input : inputs) {
+        try {
+            auto decoder = openDecoder(input);
+            auto type = decoder->type();
+            auto metadata = decoder->metadata;
+            decoder->close();
+
+            // The codec's own chunk size too, as the cache would use it
+            std::vector<size_t> sizes = chunks;
+            if (std::find(sizes.begin(), sizes.end(), decoder->chunkSize()) == sizes.end()) {
+                sizes.push_back(decoder->chunkSize());
+            }
+
+            for (size_t chunk : sizes) {
+                auto result = measure(input, chunk, seeks, rng);
+                std::printf("%s,%s,%s,%u,%u,%u,%zu,%.1f,%.2f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+                            input.name.c_str(), input.backend.c_str(), typeName(type),
+                            metadata->trackCount, metadata->sampleRate, metadata->sampleCount, chunk,
+                            result.openUs, result.decodeNsPerFrame, result.realtime, result.chunkUs,
+                            result.seekP50Us, result.seekP99Us, result.wrapUs);
+                std::fflush(stdout);
+            }
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s (%s): %s\n", input.name.c_str(), input.backend.c_str(), e.what());
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Compares the deinterleave + rdram copy kernels against the per-sample MEM_H gather that
+// Resource::Audiofile::dma used to run on every DMA request.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <mod_recomp.h>
+
+#include <extlib/dsp/pcm.hpp>
+
+constexpr size_t FRAMES = 1024;
+constexpr size_t ITERATIONS = 20000;
+constexpr int32_t RDRAM_PTR = static_cast<int32_t>(0x80100000);
+
+static volatile int16_t sSink;
+
+constexpr size_t REPEATS = 5;
+
+// Best of several runs, to filter out scheduler noise
+template <typename F>
+static double measure(F&& fn) {
+    double best = 0.0;
+
+    fn();
+
+    for (size_t r = 0; r < REPEATS; r++) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ITERATIONS; i++) {
+            fn();
+        }
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+        double perSample = elapsed.count() / (ITERATIONS * FRAMES);
+
+        if (r == 0 || perSample < best) {
+            best = perSample;
+        }
+    }
+
+    return best;
+}
+
+int main() {
+    std::vector<uint8_t> memory(0x200000);
+    uint8_t* rdram = memory.data();
+
+    std::vector<int16_t> plane(Dsp::planeStride(FRAMES));
+    std::vector<Dsp::Isa> isas = { Dsp::Isa::Scalar, Dsp::Isa::Sse2, Dsp::Isa::Avx2, Dsp::Isa::Neon };
+
+    // Speedup compares the old gather against deinterleaving a chunk once and copying it out once
+    std::printf("best isa: %s, %zu frames per chunk, ns per sample\n\n", Dsp::isaName(Dsp::bestIsa()), FRAMES);
+    std::printf("%-8s %-10s %10s %10s %10s %10s\n", "tracks", "kernel", "gather", "kernel", "copy", "speedup");
+
+    for (size_t trackCount : { 1, 2, 4, 8 }) {
+        std::vector<int16_t> interleaved(FRAMES * trackCount);
+        for (size_t i = 0; i < interleaved.size(); i++) {
+            interleaved[i] = static_cast<int16_t>(i * 31);
+        }
+
+        size_t trackNo = trackCount - 1;
+
+        double gather = measure([&]() {
+            for (size_t i = 0; i < FRAMES; i++) {
+                MEM_H(RDRAM_PTR, i * 2) = interleaved[i * trackCount + trackNo];
+            }
+            sSink = MEM_H(RDRAM_PTR, 0);
+        });
+
+        double copy = measure([&]() {
+            Dsp::copyToRdram(rdram, RDRAM_PTR, plane.data(), 0, FRAMES);
+            sSink = MEM_H(RDRAM_PTR, 0);
+        });
+
+        for (auto isa : isas) {
+            auto kernel = Dsp::deinterleaveKernel(isa, trackCount);
+            if (kernel == nullptr) {
+                continue;
+            }
+
+            double deinterleave = measure([&]() {
+                kernel(plane.data(), interleaved.data(), FRAMES, trackNo);
+                sSink = plane[0];
+            });
+
+            std::printf("%-8zu %-10s %10.3f %10.3f %10.3f %9.2fx\n", trackCount, Dsp::isaName(isa),
+                        gather, deinterleave, copy, gather / (deinterleave + copy));
+        }
+    }
+
+    return 0;
+}
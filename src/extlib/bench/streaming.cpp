@@ -0,0 +1,432 @@
+// Plays a number of streams through the extlib the way the game's audio thread does, without the
+// recomp runtime, and reports how their DMA requests were served. Streams request samples every
+// audio frame in real time, wrap around at their loop points, and now and then stop and start over.
+//
+// usage: bench_streaming [options] [files...]
+//   --streams N       concurrent streams (default 4)
+//   --seconds N       length of the run (default 30)
+//   --workers N       decode worker threads
+//   --strategy NAME   preload, on-use, no-evict, no-block or none (default on-use)
+//   --budget MB       memory cache budget
+//   --vadpcm          stream as VADPCM instead of PCM
+//   --seed N          seed for when streams stop and start
+//   --trace FILE      write a Chrome trace of the run
+//
+// Streams take turns using the given files, each with a resource of its own. Without files, a
+// synthetic stereo WAV is written to the temp directory and used by every stream.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+#include <mod_recomp.h>
+
+#include <extlib/cache/diskcache.hpp>
+#include <extlib/dsp/vadpcm.hpp>
+#include <extlib/main.hpp>
+#include <extlib/resource/audiofile.hpp>
+#include <extlib/stats.hpp>
+#include <extlib/trace.hpp>
+#include <extlib/thread.hpp>
+#include <extlib/vfs/native_file.hpp>
+
+#include "synth.hpp"
+
+namespace fs = std::filesystem;
+
+// Normally defined by the native entry points, which need the recomp runtime
+Cache::Manager gCacheManager;
+Cache::ProbeIndex gProbeIndex;
+Resource::Registry gResources;
+
+constexpr int FRAMES_PER_SECOND = 60;
+constexpr int UPDATES_PER_FRAME = 3;
+constexpr size_t SAMPLES_PER_FRAME = 16;
+constexpr size_t RDRAM_SIZE = 0x800000;
+constexpr uint32_t RDRAM_BASE = 0x80000000;
+constexpr size_t STREAM_BUFFER_SIZE = 0x8000;
+constexpr size_t MAX_TRACKS = 16;
+
+constexpr double MIN_PLAY_SECONDS = 5.0;
+constexpr double MAX_PLAY_SECONDS = 20.0;
+constexpr double MIN_STOP_SECONDS = 0.5;
+constexpr double MAX_STOP_SECONDS = 3.0;
+
+constexpr uint32_t SYNTH_SAMPLE_RATE = 44100;
+constexpr uint32_t SYNTH_SECONDS = 20;
+
+struct Options {
+    size_t streams = 4;
+    double seconds = 30.0;
+    size_t workers = std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, 4);
+    Resource::CacheStrategy strategy = Resource::CacheStrategy::PreloadOnUse;
+    size_t budget = 0;
+    bool vadpcm = false;
+    uint32_t seed = 1;
+    fs::path trace;
+    std::vector<fs::path> files;
+};
+
+struct Stream {
+    size_t resourceId;
+    std::shared_ptr<Resource::Audiofile> resource;
+    int32_t ptr;
+    bool playing = true;
+    double pos = 0.0;
+    std::chrono::steady_clock::time_point toggleAt;
+};
+
+struct Results {
+    std::vector<uint32_t> latencies;
+    size_t requests = 0;
+    size_t misses = 0;
+    size_t loops = 0;
+    size_t starts = 0;
+    size_t peakCacheBytes = 0;
+    std::chrono::nanoseconds worstFrame{0};
+};
+
+static double cpuSeconds(bool thread) {
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    BOOL ok = thread
+        ? GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)
+        : GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    if (!ok) {
+        return 0.0;
+    }
+    auto ticks = [](FILETIME t) {
+        return (static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) / 1e7;
+#else
+    timespec ts;
+    clock_gettime(thread ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+// Peak resident memory of the whole process in bytes, or 0 where it isn't known
+static size_t peakResidentBytes() {
+#if defined(_WIN32)
+    return 0;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024ull;
+#endif
+#endif
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            return i + 1 < argc ? argv[++i] : "";
+        };
+
+        if (arg == "--streams") {
+            options.streams = std::max<size_t>(std::stoul(value()), 1);
+        } else if (arg == "--seconds") {
+            options.seconds = std::stod(value());
+        } else if (arg == "--workers") {
+            options.workers = std::stoul(value());
+        } else if (arg == "--budget") {
+            options.budget = std::stoul(value()) * 1024 * 1024;
+        } else if (arg == "--vadpcm") {
+            options.vadpcm = true;
+        } else if (arg == "--trace") {
+            options.trace = value();
+        } else if (arg == "--seed") {
+            options.seed = std::stoul(value());
+        } else if (arg == "--strategy") {
+            std::string name = value();
+            if (name == "preload") {
+                options.strategy = Resource::CacheStrategy::Preload;
+            } else if (name == "on-use") {
+                options.strategy = Resource::CacheStrategy::PreloadOnUse;
+            } else if (name == "no-evict") {
+                options.strategy = Resource::CacheStrategy::PreloadOnUseNoEvict;
+            } else if (name == "no-block") {
+                options.strategy = Resource::CacheStrategy::PreloadOnUseNoBlock;
+            } else if (name == "none") {
+                options.strategy = Resource::CacheStrategy::None;
+            } else {
+                std::fprintf(stderr, "Unknown strategy %s\n", name.c_str());
+                return false;
+            }
+        } else if (arg.starts_with("--")) {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        } else {
+            options.files.emplace_back(arg);
+        }
+    }
+
+    return true;
+}
+
+// Registers a file the way AudioApiNative_AddAudioFile does, minus the probe index
+static std::shared_ptr<Resource::Audiofile> addFile(const fs::path& path, const Options& options, size_t& resourceId) {
+    auto file = std::make_shared<Vfs::NativeFile>(path);
+    auto resource = std::make_shared<Resource::Audiofile>(file, Decoder::Type::Auto, options.strategy);
+
+    resource->open();
+    resource->probe();
+    resource->close();
+
+    if (options.vadpcm) {
+        resource->enableVadpcm();
+    }
+
+    resourceId = gResources.add(resource);
+    queuePreload(resourceId);
+    return resource;
+}
+
+static size_t totalCacheBytes() {
+    size_t bytes = 0;
+
+    gResources.forEach([&](size_t resourceId, const Resource::ResourcePtr& resource) {
+        bytes += resource->cacheSize();
+    });
+
+    return bytes;
+}
+
+static size_t align16(size_t value) {
+    return (value + 0xF) & ~static_cast<size_t>(0xF);
+}
+
+// One request the way synthesis makes it: samples as they are for PCM, whole 9 byte frames from a
+// 16 byte boundary for VADPCM. Whether the chunks were cached beforehand counts as a hit or a miss.
+static void request(Stream& stream, uint8_t* rdram, size_t offset, size_t count, Results& stats) {
+    auto& resource = *stream.resource;
+    uint32_t trackCount = std::min<uint32_t>(resource.metadata->trackCount, MAX_TRACKS);
+    size_t last = std::min<size_t>(offset + count, resource.metadata->sampleCount) - 1;
+
+    size_t dmaOffset = offset, dmaCount = count;
+    if (resource.isVadpcm()) {
+        size_t byteOffset = offset / Dsp::VADPCM_FRAME_SAMPLES * Dsp::VADPCM_FRAME_BYTES;
+        size_t size = align16(Dsp::vadpcmFrames(count) * Dsp::VADPCM_FRAME_BYTES + SAMPLES_PER_FRAME);
+        dmaOffset = byteOffset & ~static_cast<size_t>(0xF);
+        dmaCount = align16(size + (byteOffset - dmaOffset));
+    }
+
+    for (uint32_t trackNo = 0; trackNo < trackCount; trackNo++) {
+        bool hit = resource.hasChunk(offset) && resource.hasChunk(last);
+        int32_t ptr = stream.ptr + static_cast<int32_t>(trackNo * STREAM_BUFFER_SIZE / MAX_TRACKS);
+
+        Trace::Span span("dma", stream.resourceId);
+
+        auto start = std::chrono::steady_clock::now();
+        resource.touch();
+        resource.dma(rdram, ptr, dmaOffset, dmaCount, trackNo, 0);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        stats.latencies.push_back(static_cast<uint32_t>(std::min<int64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), UINT32_MAX)));
+        stats.requests++;
+        stats.misses += hit ? 0 : 1;
+    }
+
+    queuePreload(stream.resourceId);
+}
+
+// One audio frame of a stream, split into updates like the synthesis. An update that crosses the
+// loop end is requested as two, the second from the loop start.
+static void playFrame(Stream& stream, uint8_t* rdram, Results& stats) {
+    const auto& metadata = *stream.resource->metadata;
+    size_t loopStart = metadata.loopStart;
+    size_t loopEnd = metadata.loopEnd > loopStart && metadata.loopEnd <= metadata.sampleCount
+        ? metadata.loopEnd
+        : metadata.sampleCount;
+    double perUpdate = static_cast<double>(metadata.sampleRate) / (FRAMES_PER_SECOND * UPDATES_PER_FRAME);
+
+    for (int update = 0; update < UPDATES_PER_FRAME; update++) {
+        size_t offset = static_cast<size_t>(stream.pos);
+        size_t count = static_cast<size_t>(stream.pos + perUpdate) - offset;
+
+        // The extra frame overlaps the next update, as the synthesis loads it
+        size_t wanted = count + SAMPLES_PER_FRAME;
+
+        if (offset + wanted > loopEnd) {
+            request(stream, rdram, offset, loopEnd - offset, stats);
+            request(stream, rdram, loopStart, wanted - (loopEnd - offset), stats);
+        } else {
+            request(stream, rdram, offset, wanted, stats);
+        }
+
+        stream.pos += perUpdate;
+        if (stream.pos >= loopEnd) {
+            stream.pos = loopStart + (stream.pos - loopEnd);
+            stats.loops++;
+        }
+    }
+}
+
+static double percentile(std::vector<uint32_t>& values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(p / 100.0 * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index] / 1000.0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    if (options.files.empty()) {
+        options.files.push_back(writeSyntheticWav(SYNTH_SAMPLE_RATE, 2, SYNTH_SECONDS));
+    }
+
+    Cache::DiskCache::enabled.store(false);
+    if (options.budget > 0) {
+        gCacheManager.setBudget(options.budget);
+    }
+
+    if (!options.trace.empty()) {
+        Trace::setOutputPath(options.trace);
+        Trace::start();
+    }
+
+    setWorkerCount(options.workers);
+    workerPoolStart();
+    std::thread(workerThreadLoop).detach();
+
+    std::vector<uint8_t> memory(RDRAM_SIZE);
+    uint8_t* rdram = memory.data();
+
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<double> playTime(MIN_PLAY_SECONDS, MAX_PLAY_SECONDS);
+    std::uniform_real_distribution<double> stopTime(MIN_STOP_SECONDS, MAX_STOP_SECONDS);
+    std::uniform_real_distribution<double> startAt(0.0, 1.0);
+
+    auto seconds = [](double s) {
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(s));
+    };
+
+    if ((options.streams + 1) * STREAM_BUFFER_SIZE > RDRAM_SIZE) {
+        std::fprintf(stderr, "Too many streams\n");
+        return 1;
+    }
+
+    std::vector<Stream> streams;
+    auto begin = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < options.streams; i++) {
+        const auto& path = options.files[i % options.files.size()];
+        try {
+            Stream stream;
+            stream.resource = addFile(path, options, stream.resourceId);
+            stream.ptr = static_cast<int32_t>(RDRAM_BASE + i * STREAM_BUFFER_SIZE);
+            stream.toggleAt = begin + seconds(playTime(rng));
+            streams.push_back(std::move(stream));
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "Failed to add %s: %s\n", path.string().c_str(), e.what());
+            return 1;
+        }
+    }
+
+    Results stats;
+    auto frameInterval = std::chrono::nanoseconds(1'000'000'000 / FRAMES_PER_SECOND);
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + seconds(options.seconds);
+    double cpuStart = cpuSeconds(false);
+    double mainCpuStart = cpuSeconds(true);
+    auto nextFrame = start;
+
+    while (nextFrame < end) {
+        std::this_thread::sleep_until(nextFrame);
+        auto now = std::chrono::steady_clock::now();
+        auto frameStart = now;
+
+        workerThreadTick();
+
+        for (auto& stream : streams) {
+            if (now >= stream.toggleAt) {
+                stream.playing = !stream.playing;
+                stream.toggleAt = now + seconds(stream.playing ? playTime(rng) : stopTime(rng));
+
+                // Half the restarts begin somewhere in the middle, like a resumed or seeking track
+                if (stream.playing) {
+                    stream.pos = startAt(rng) < 0.5
+                        ? 0.0
+                        : static_cast<double>(stream.resource->metadata->sampleCount) * startAt(rng);
+                    stats.starts++;
+                }
+            }
+
+            if (stream.playing) {
+                playFrame(stream, rdram, stats);
+            }
+        }
+
+        stats.worstFrame = std::max(stats.worstFrame,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - frameStart));
+        stats.peakCacheBytes = std::max(stats.peakCacheBytes, totalCacheBytes());
+
+        nextFrame += frameInterval;
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!options.trace.empty() && !Trace::stop()) {
+        std::fprintf(stderr, "Failed to write %s\n", options.trace.string().c_str());
+    }
+    double workerCpu = (cpuSeconds(false) - cpuStart) - (cpuSeconds(true) - mainCpuStart);
+    uint32_t underruns = 0;
+    for (const auto& stream : streams) {
+        underruns += stream.resource->underruns.load();
+    }
+
+    std::printf("%zu streams, %.1f s, %zu workers, %s\n", streams.size(), wall, options.workers,
+                options.vadpcm ? "vadpcm" : "pcm");
+    std::printf("requests        %zu\n", stats.requests);
+    std::printf("misses          %zu (%.2f%%)\n", stats.misses,
+                stats.requests ? 100.0 * stats.misses / stats.requests : 0.0);
+    std::printf("underruns       %u\n", underruns);
+    std::printf("loops / starts  %zu / %zu\n", stats.loops, stats.starts);
+    std::printf("latency us      p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+                percentile(stats.latencies, 50), percentile(stats.latencies, 90),
+                percentile(stats.latencies, 99), percentile(stats.latencies, 99.9),
+                percentile(stats.latencies, 100));
+    std::printf("worst frame     %.2f ms\n", stats.worstFrame.count() / 1e6);
+    std::printf("worker cpu      %.1f%% of %zu threads\n",
+                100.0 * workerCpu / (wall * std::max<size_t>(options.workers, 1)), options.workers);
+    auto counters = Stats::collect(-1);
+    std::printf("main decode     %.1f ms\n", counters.mainThreadDecodeNs / 1e6);
+    std::printf("evictions       %llu (%.1f MiB)\n", static_cast<unsigned long long>(counters.evictions),
+                counters.evictedBytes / (1024.0 * 1024.0));
+    std::printf("peak cache      %.1f MiB\n", stats.peakCacheBytes / (1024.0 * 1024.0));
+    if (size_t rss = peakResidentBytes()) {
+        std::printf("peak rss        %.1f MiB\n", rss / (1024.0 * 1024.0));
+    }
+
+    // Workers are detached and may still be decoding, so skip static destructors
+    std::fflush(stdout);
+    std::quick_exit(0);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// Test audio for the benchmarks that need files to decode
+
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Chords with a slow tremolo and a little noise, so it neither compresses to nothing nor sounds like
+// white noise. Each channel is a bit quieter than the one before it.
+inline std::vector<int16_t> synthesizeMusic(uint32_t sampleRate, uint32_t channels, uint32_t frames) {
+    constexpr double TAU = 6.283185307179586;
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> noise(-200, 200);
+    std::vector<int16_t> samples(static_cast<size_t>(frames) * channels);
+
+    for (uint32_t i = 0; i < frames; i++) {
+        double t = static_cast<double>(i) / sampleRate;
+        double root = 110.0 * (1 + (i / (sampleRate * 2)) % 4);
+        double tremolo = 0.6 + 0.4 * std::sin(TAU * 0.5 * t);
+        double v = tremolo * (6000 * std::sin(TAU * root * t) +
+                              3000 * std::sin(TAU * root * 1.5 * t) +
+                              2000 * std::sin(TAU * root * 2.0 * t));
+
+        for (uint32_t c = 0; c < channels; c++) {
+            samples[static_cast<size_t>(i) * channels + c] = static_cast<int16_t>(v * (1.0 - 0.1 * c) + noise(rng));
+        }
+    }
+
+    return samples;
+}
+
+inline void writeWav(const fs::path& path, uint32_t sampleRate, uint32_t channels, const std::vector<int16_t>& samples) {
+    uint32_t dataBytes = static_cast<uint32_t>(samples.size() * sizeof(int16_t));
+
+    std::ofstream out(path, std::ios::binary);
+    auto u32 = [&](uint32_t v) { out.write(reinterpret_cast<const char*>(&v), 4); };
+    auto u16 = [&](uint16_t v) { out.write(reinterpret_cast<const char*>(&v), 2); };
+
+    out.write("RIFF", 4); u32(36 + dataBytes); out.write("WAVE", 4);
+    out.write("fmt ", 4); u32(16); u16(1); u16(channels); u32(sampleRate);
+    u32(sampleRate * channels * 2); u16(channels * 2); u16(16);
+    out.write("data", 4); u32(dataBytes);
+    out.write(reinterpret_cast<const char*>(samples.data()), dataBytes);
+}
+
+// Writes a WAV of synthesizeMusic to the temp directory and returns its path
+inline fs::path writeSyntheticWav(uint32_t sampleRate, uint32_t channels, uint32_t seconds) {
+    fs::path path = fs::temp_directory_path() /
+        ("audioapi_bench_" + std::to_string(channels) + "ch_" + std::to_string(sampleRate) + ".wav");
+
+    writeWav(path, sampleRate, channels, synthesizeMusic(sampleRate, channels, sampleRate * seconds));
+    return path;
+}
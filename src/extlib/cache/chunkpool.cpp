@@ -0,0 +1,58 @@
+#include <extlib/cache/chunkpool.hpp>
+
+namespace Cache {
+
+void ChunkPool::reset(size_t chunkSamples) {
+    slabs.clear();
+    this->chunkSamples = chunkSamples;
+    usedChunks = 0;
+}
+
+uint32_t ChunkPool::alloc() {
+    size_t i;
+
+    // Filling the lowest slabs first keeps the others free to be released
+    for (i = 0; i < slabs.size(); i++) {
+        if (slabs[i].data && !slabs[i].free.empty()) {
+            break;
+        }
+    }
+
+    if (i == slabs.size()) {
+        for (i = 0; i < slabs.size(); i++) {
+            if (!slabs[i].data) {
+                break;
+            }
+        }
+        if (i == slabs.size()) {
+            slabs.emplace_back();
+        }
+
+        auto& slab = slabs[i];
+        slab.data = std::make_unique_for_overwrite<int16_t[]>(CHUNKS_PER_SLAB * chunkSamples);
+        slab.free.resize(CHUNKS_PER_SLAB);
+        for (uint32_t j = 0; j < CHUNKS_PER_SLAB; j++) {
+            slab.free[j] = i * CHUNKS_PER_SLAB + (CHUNKS_PER_SLAB - 1 - j);
+        }
+    }
+
+    auto& slab = slabs[i];
+    uint32_t slot = slab.free.back();
+    slab.free.pop_back();
+    usedChunks++;
+
+    return slot;
+}
+
+void ChunkPool::free(uint32_t slot) {
+    auto& slab = slabs[slot / CHUNKS_PER_SLAB];
+    slab.free.push_back(slot);
+    usedChunks--;
+
+    if (slab.free.size() == CHUNKS_PER_SLAB) {
+        slab.data.reset();
+        slab.free.clear();
+    }
+}
+
+} // namespace Cache
@@ -0,0 +1,88 @@
+#include <extlib/cache/chunktable.hpp>
+
+namespace Cache {
+
+ChunkTable::ChunkTable() : entries(MIN_CAPACITY), mask(MIN_CAPACITY - 1) {}
+
+size_t ChunkTable::home(uint32_t chunkNo) const {
+    // Fibonacci hashing spreads consecutive chunk numbers across the table
+    return (static_cast<uint64_t>(chunkNo) * 0x9E3779B97F4A7C15ull >> 32) & mask;
+}
+
+uint32_t ChunkTable::find(uint32_t chunkNo) const {
+    for (size_t i = home(chunkNo); ; i = (i + 1) & mask) {
+        const auto& entry = entries[i];
+        if (entry.chunkNo == chunkNo) {
+            return entry.slot;
+        }
+        if (entry.chunkNo == EMPTY) {
+            return NOT_FOUND;
+        }
+    }
+}
+
+bool ChunkTable::insert(uint32_t chunkNo, uint32_t slot) {
+    if ((count + 1) * 4 > entries.size() * 3) {
+        rehash(entries.size() * 2);
+    }
+
+    for (size_t i = home(chunkNo); ; i = (i + 1) & mask) {
+        auto& entry = entries[i];
+        if (entry.chunkNo == chunkNo) {
+            return false;
+        }
+        if (entry.chunkNo == EMPTY) {
+            entry = { chunkNo, slot };
+            count++;
+            return true;
+        }
+    }
+}
+
+uint32_t ChunkTable::erase(uint32_t chunkNo) {
+    size_t i = home(chunkNo);
+
+    while (entries[i].chunkNo != chunkNo) {
+        if (entries[i].chunkNo == EMPTY) {
+            return NOT_FOUND;
+        }
+        i = (i + 1) & mask;
+    }
+
+    uint32_t slot = entries[i].slot;
+
+    // Pull back any entry further along the run that would no longer be reachable from its home
+    for (size_t j = (i + 1) & mask; entries[j].chunkNo != EMPTY; j = (j + 1) & mask) {
+        size_t k = home(entries[j].chunkNo);
+        if (((j - k) & mask) >= ((j - i) & mask)) {
+            entries[i] = entries[j];
+            i = j;
+        }
+    }
+
+    entries[i] = {};
+    count--;
+
+    return slot;
+}
+
+void ChunkTable::clear() {
+    entries.assign(MIN_CAPACITY, {});
+    mask = MIN_CAPACITY - 1;
+    count = 0;
+}
+
+void ChunkTable::rehash(size_t capacity) {
+    std::vector<Entry> old(capacity);
+    old.swap(entries);
+    mask = capacity - 1;
+    count = 0;
+
+    for (const auto& entry : old) {
+        if (entry.chunkNo != EMPTY) {
+            insert(entry.chunkNo, entry.slot);
+        }
+    }
+}
+
+} // namespace Cache
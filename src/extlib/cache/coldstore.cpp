@@ -0,0 +1,203 @@
+#include <extlib/cache/coldstore.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+namespace Cache {
+
+constexpr size_t BLOCK_SIZE = 256;
+constexpr int ORDER_BITS = 2;
+constexpr int PARAM_BITS = 5;
+constexpr int MAX_ORDER = 2;
+
+// Quotients this large are written as raw residuals instead, which never need more than 18 bits
+constexpr uint32_t ESCAPE = 32;
+constexpr int RAW_BITS = 18;
+
+namespace {
+
+class BitWriter {
+public:
+    BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+    // Up to 32 bits at a time
+    void put(uint32_t value, int bits) {
+        acc |= static_cast<uint64_t>(value) << count;
+        count += bits;
+        while (count >= 8) {
+            out.push_back(static_cast<uint8_t>(acc));
+            acc >>= 8;
+            count -= 8;
+        }
+    }
+
+    void flush() {
+        if (count > 0) {
+            out.push_back(static_cast<uint8_t>(acc));
+        }
+        acc = 0;
+        count = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t acc = 0;
+    int count = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : p(data), end(data + size) {}
+
+    uint32_t get(int bits) {
+        refill();
+        uint32_t value = static_cast<uint32_t>(acc & ((1ull << bits) - 1));
+        acc >>= bits;
+        count -= bits;
+        return value;
+    }
+
+    // Returns ESCAPE for a run of ESCAPE ones, which has no terminating zero
+    uint32_t unary() {
+        refill();
+        uint32_t ones = std::min<uint32_t>(std::countr_one(acc), ESCAPE);
+        int bits = ones == ESCAPE ? ESCAPE : ones + 1;
+        acc >>= bits;
+        count -= bits;
+        return ones;
+    }
+
+private:
+    // Reading past the end yields zeros, so a corrupt stream can't read out of bounds
+    void refill() {
+        while (count <= 56) {
+            acc |= static_cast<uint64_t>(p < end ? *p++ : 0) << count;
+            count += 8;
+        }
+    }
+
+    const uint8_t* p;
+    const uint8_t* end;
+    uint64_t acc = 0;
+    int count = 0;
+};
+
+} // namespace
+
+static inline uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+// Fixed polynomial predictors: silence or noise, a straight line, a parabola
+static inline int32_t predict(int order, int32_t prev1, int32_t prev2) {
+    switch (order) {
+    case 0:  return 0;
+    case 1:  return prev1;
+    default: return 2 * prev1 - prev2;
+    }
+}
+
+void compressPlane(std::vector<uint8_t>& out, const int16_t* plane, size_t samples) {
+    BitWriter writer(out);
+    uint32_t residuals[MAX_ORDER + 1][BLOCK_SIZE];
+    int32_t prev1 = 0, prev2 = 0;
+
+    for (size_t start = 0; start < samples; start += BLOCK_SIZE) {
+        size_t n = std::min(BLOCK_SIZE, samples - start);
+        uint64_t sums[MAX_ORDER + 1] = {};
+
+        for (size_t i = 0; i < n; i++) {
+            int32_t sample = plane[(start + i) ^ 1];
+            for (int order = 0; order <= MAX_ORDER; order++) {
+                residuals[order][i] = zigzag(sample - predict(order, prev1, prev2));
+                sums[order] += residuals[order][i];
+            }
+            prev2 = prev1;
+            prev1 = sample;
+        }
+
+        // Each block uses whichever predictor leaves the smallest residuals
+        int order = std::min_element(sums, sums + MAX_ORDER + 1) - sums;
+        const uint32_t* residual = residuals[order];
+
+        // Close to the best Rice parameter for a geometric distribution with this mean
+        uint32_t k = std::min<uint32_t>(std::bit_width(sums[order] / n), RAW_BITS - 1);
+        k = k > 0 ? k - 1 : 0;
+        writer.put(order, ORDER_BITS);
+        writer.put(k, PARAM_BITS);
+
+        for (size_t i = 0; i < n; i++) {
+            uint32_t q = residual[i] >> k;
+
+            if (q < ESCAPE) {
+                writer.put((1u << q) - 1, q + 1);
+                writer.put(residual[i] & ((1u << k) - 1), k);
+            } else {
+                writer.put(UINT32_MAX, ESCAPE);
+                writer.put(residual[i], RAW_BITS);
+            }
+        }
+    }
+
+    writer.flush();
+}
+
+void decompressPlane(const uint8_t* data, size_t size, int16_t* plane, size_t samples) {
+    BitReader reader(data, size);
+    int32_t prev1 = 0, prev2 = 0;
+
+    for (size_t start = 0; start < samples; start += BLOCK_SIZE) {
+        size_t n = std::min(BLOCK_SIZE, samples - start);
+        int order = reader.get(ORDER_BITS);
+        int k = reader.get(PARAM_BITS);
+
+        for (size_t i = 0; i < n; i++) {
+            uint32_t q = reader.unary();
+            uint32_t residual = q == ESCAPE
+                ? reader.get(RAW_BITS)
+                : (q << k) | reader.get(k);
+
+            // Valid planes always decode to 16-bit samples, and clamping keeps a corrupt one from
+            // overflowing the predictor
+            int32_t sample = static_cast<int32_t>(std::clamp<int64_t>(
+                static_cast<int64_t>(unzigzag(residual)) + predict(order, prev1, prev2), INT16_MIN, INT16_MAX));
+            plane[(start + i) ^ 1] = static_cast<int16_t>(sample);
+            prev2 = prev1;
+            prev1 = sample;
+        }
+    }
+}
+
+// Takes a plane compressed with compressPlane, which is best done before taking the cache lock
+void ColdStore::store(uint32_t key, std::vector<uint8_t> data) {
+    data.shrink_to_fit();
+
+    erase(key);
+    bytes += data.size();
+    planes.emplace(key, std::move(data));
+}
+
+bool ColdStore::load(uint32_t key, int16_t* plane, size_t samples) const {
+    auto it = planes.find(key);
+    if (it == planes.end()) {
+        return false;
+    }
+
+    decompressPlane(it->second.data(), it->second.size(), plane, samples);
+    return true;
+}
+
+void ColdStore::erase(uint32_t key) {
+    auto it = planes.find(key);
+    if (it != planes.end()) {
+        bytes -= it->second.size();
+        planes.erase(it);
+    }
+}
+
+} // namespace Cache
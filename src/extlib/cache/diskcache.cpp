@@ -0,0 +1,205 @@
+#include <extlib/cache/diskcache.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <plog/Log.h>
+
+namespace Cache {
+
+constexpr char DISK_CACHE_MAGIC[4] = { 'A', 'A', 'P', 'C' };
+constexpr uint32_t DISK_CACHE_VERSION = 2;
+constexpr size_t DISK_CACHE_ALIGN = 4096;
+constexpr const char* DISK_CACHE_EXTENSION = ".pcm";
+constexpr uint64_t DISK_CACHE_MAX_BYTES = 2ull * 1024 * 1024 * 1024;
+constexpr auto DISK_CACHE_MAX_AGE = std::chrono::hours(24 * 30);
+constexpr uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325;
+constexpr uint64_t FNV_PRIME = 0x100000001B3;
+
+struct DiskCache::Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t numChunks;
+    uint32_t reserved;
+    DiskCacheKey key;
+};
+
+std::atomic<bool> DiskCache::enabled = true;
+fs::path DiskCache::directory;
+
+static size_t alignUp(size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+}
+
+// Set once during init, before any worker can read it
+void DiskCache::setDirectory(fs::path dir) {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+
+    if (ec) {
+        PLOG_WARNING << "Disk cache disabled, could not create " << dir << ": " << ec.message();
+        return;
+    }
+
+    directory = dir;
+}
+
+bool DiskCache::isEnabled() {
+    return enabled.load() && !directory.empty();
+}
+
+// Run once at startup, before any cache file is opened
+void DiskCache::prune() {
+    if (directory.empty()) {
+        return;
+    }
+
+    struct Entry {
+        fs::path path;
+        fs::file_time_type mtime;
+        uint64_t size;
+    };
+
+    std::error_code ec;
+    std::vector<Entry> entries;
+
+    for (const auto& dirEntry : fs::directory_iterator(directory, ec)) {
+        if (dirEntry.path().extension() != DISK_CACHE_EXTENSION || !dirEntry.is_regular_file(ec)) {
+            continue;
+        }
+        entries.push_back({ dirEntry.path(), dirEntry.last_write_time(ec), dirEntry.file_size(ec) });
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+        return a.mtime > b.mtime;
+    });
+
+    auto expiry = fs::file_time_type::clock::now() - DISK_CACHE_MAX_AGE;
+    uint64_t total = 0;
+
+    for (const auto& entry : entries) {
+        total += entry.size;
+        if (total > DISK_CACHE_MAX_BYTES || entry.mtime < expiry) {
+            PLOG_DEBUG << "Disk cache pruned: " << entry.path;
+            fs::remove(entry.path, ec);
+        }
+    }
+}
+
+// Names the cache file after the source path and the decoder settings, so the same file decoded
+// two ways gets two files. The source's size and fingerprint are left out, so a changed source
+// replaces its old entry instead of adding one.
+static fs::path cacheFileName(const std::string& sourcePath, const DiskCacheKey& key) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (unsigned char c : sourcePath) {
+        hash = (hash ^ c) * FNV_PRIME;
+    }
+
+    const uint32_t settings[] = { key.codec, key.trackCount, key.sampleRate, key.chunkFrames, key.planeStride };
+    const auto* bytes = reinterpret_cast<const unsigned char*>(settings);
+    for (size_t i = 0; i < sizeof(settings); i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(hash), DISK_CACHE_EXTENSION);
+    return name;
+}
+
+// Opens the cache file for a source, starting over when it was made from different audio or with
+// different decoder settings. Writes go to the shared mapping, so they survive the process exiting
+// without this destructor running.
+DiskCache::DiskCache(const std::string& sourcePath, const DiskCacheKey& key) {
+    if (!isEnabled()) {
+        throw std::runtime_error("Disk cache error: disabled");
+    }
+
+    numChunks = (key.sampleCount + key.chunkFrames - 1) / key.chunkFrames;
+    chunkSamples = static_cast<size_t>(key.planeStride) * key.trackCount;
+
+    size_t presentOffset = sizeof(Header);
+    size_t chunksOffset = alignUp(presentOffset + numChunks, DISK_CACHE_ALIGN);
+    size_t size = chunksOffset + numChunks * chunkSamples * sizeof(int16_t);
+
+    auto path = directory / cacheFileName(sourcePath, key);
+
+    map.open(path, size);
+
+    header = reinterpret_cast<Header*>(map.data());
+    present = map.data() + presentOffset;
+    chunks = reinterpret_cast<int16_t*>(map.data() + chunksOffset);
+    this->chunksOffset = chunksOffset;
+
+    bool valid = std::memcmp(header->magic, DISK_CACHE_MAGIC, sizeof(DISK_CACHE_MAGIC)) == 0 &&
+                 header->version == DISK_CACHE_VERSION &&
+                 header->numChunks == numChunks &&
+                 header->key == key;
+
+    if (!valid) {
+        PLOG_DEBUG << "Disk cache reset: " << path;
+        std::memset(map.data(), 0, chunksOffset);
+        std::memcpy(header->magic, DISK_CACHE_MAGIC, sizeof(DISK_CACHE_MAGIC));
+        header->version = DISK_CACHE_VERSION;
+        header->numChunks = numChunks;
+        header->key = key;
+
+        // The cleared flags have to reach the disk before anything new is marked present
+        map.flush(0, chunksOffset);
+    }
+
+    available.assign(present, present + numChunks);
+    for (uint32_t i = 0; i < numChunks; i++) {
+        presentChunks += present[i] != 0;
+    }
+
+    // Marks the file as recently used for prune, which goes by modification time
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+}
+
+DiskCache::~DiskCache() {
+    if (header == nullptr) {
+        return;
+    }
+
+    sync();
+}
+
+// Marks a chunk as filled in, after its data was written through data()
+void DiskCache::commit(uint32_t chunkNo) {
+    if (chunkNo < numChunks && available[chunkNo] == 0) {
+        available[chunkNo] = 1;
+        presentChunks++;
+        pending.push_back(chunkNo);
+    }
+}
+
+void DiskCache::sync() {
+    if (pending.empty()) {
+        return;
+    }
+
+    std::sort(pending.begin(), pending.end());
+
+    // Neighbouring chunks are flushed together, and the flags only once all the data is out
+    size_t chunkBytes = chunkSamples * sizeof(int16_t);
+    for (size_t i = 0; i < pending.size();) {
+        size_t j = i + 1;
+        while (j < pending.size() && pending[j] == pending[j - 1] + 1) {
+            j++;
+        }
+        map.flush(chunksOffset + pending[i] * chunkBytes, (j - i) * chunkBytes);
+        i = j;
+    }
+
+    for (uint32_t chunkNo : pending) {
+        present[chunkNo] = 1;
+    }
+    map.flush(sizeof(Header) + pending.front(), pending.back() - pending.front() + 1);
+
+    pending.clear();
+}
+
+} // namespace Cache
@@ -0,0 +1,138 @@
+#include <extlib/cache/manager.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <plog/Log.h>
+
+#include <extlib/main.hpp>
+#include <extlib/resource/abstract.hpp>
+
+namespace Cache {
+
+void Manager::setBudget(size_t bytes) {
+    budget.store(bytes);
+}
+
+void Manager::setQuota(fs::path owner, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (bytes == 0) {
+        quotas.erase(owner);
+    } else {
+        quotas[owner] = bytes;
+    }
+}
+
+void Manager::setOwner(size_t resourceId, fs::path owner) {
+    std::lock_guard<std::mutex> lock(mutex);
+    owners[resourceId] = owner;
+}
+
+void Manager::enforce() {
+    struct Entry {
+        size_t resourceId;
+        Resource::ResourcePtr resource;
+        fs::path owner;
+        size_t size = 0;
+    };
+
+    std::vector<Entry> entries;
+    entries.reserve(gResources.size());
+
+    // Visited in id order, which the clock hand relies on
+    gResources.forEach([&](size_t resourceId, const Resource::ResourcePtr& resource) {
+        entries.push_back({ resourceId, resource });
+    });
+
+    if (entries.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::unordered_map<fs::path, size_t> usage;
+    size_t total = 0;
+    int maxWeight = 0;
+
+    for (auto& entry : entries) {
+        auto it = owners.find(entry.resourceId);
+        if (it != owners.end()) {
+            entry.owner = it->second;
+        }
+        entry.size = entry.resource->cacheSize();
+        usage[entry.owner] += entry.size;
+        total += entry.size;
+        maxWeight = std::max(maxWeight, entry.resource->evictionWeight());
+    }
+
+    size_t limit = budget.load();
+
+    auto overQuota = [&](const fs::path& owner) -> size_t {
+        auto it = quotas.find(owner);
+        if (it == quotas.end() || usage[owner] <= it->second) {
+            return 0;
+        }
+        return usage[owner] - it->second;
+    };
+
+    auto overBudget = [&]() -> size_t {
+        return (limit > 0 && total > limit) ? total - limit : 0;
+    };
+
+    auto isOver = [&]() {
+        if (overBudget() > 0) {
+            return true;
+        }
+        for (const auto& [ owner, bytes ] : quotas) {
+            if (overQuota(owner) > 0) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    if (!isOver()) {
+        return;
+    }
+
+    // Weighted CLOCK: each access gives a resource as many chances as its eviction weight, and every
+    // pass of the hand takes one away. A resource is only asked to evict once it has none left.
+    size_t start = std::lower_bound(entries.begin(), entries.end(), hand, [](const auto& entry, size_t id) {
+        return entry.resourceId < id;
+    }) - entries.begin();
+
+    size_t steps = entries.size() * (maxWeight + 1);
+    size_t evicted = 0;
+
+    for (size_t step = 0; step < steps && isOver(); step++) {
+        auto& entry = entries[(start + step) % entries.size()];
+
+        size_t need = std::max(overBudget(), overQuota(entry.owner));
+        if (need == 0 || entry.size == 0) {
+            continue;
+        }
+
+        if (entry.resource->clockCredit.load(std::memory_order_relaxed) > 0) {
+            entry.resource->clockCredit.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Resources count what they drop themselves, along with what gc drops
+        size_t freed = std::min(entry.resource->evict(need), entry.size);
+
+        entry.size -= freed;
+        usage[entry.owner] -= freed;
+        total -= freed;
+        evicted += freed;
+
+        hand = entry.resourceId + 1;
+    }
+
+    if (evicted > 0) {
+        PLOG_DEBUG << "Cache evicted " << evicted << " bytes, " << total << " bytes resident";
+    }
+}
+
+} // namespace Cache
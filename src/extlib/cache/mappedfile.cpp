@@ -0,0 +1,140 @@
+#include <extlib/cache/mappedfile.hpp>
+
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace Cache {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#if defined(_WIN32)
+
+void MappedFile::open(const fs::path& path, size_t size) {
+    close();
+
+    file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                       OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        throw std::runtime_error("Mapped file error: failed to open " + path.string());
+    }
+
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFilePointerEx(file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+        close();
+        throw std::runtime_error("Mapped file error: failed to resize " + path.string());
+    }
+
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32),
+                                 static_cast<DWORD>(size & 0xFFFFFFFF), nullptr);
+    if (mapping == nullptr) {
+        close();
+        throw std::runtime_error("Mapped file error: failed to map " + path.string());
+    }
+
+    ptr = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+    if (ptr == nullptr) {
+        close();
+        throw std::runtime_error("Mapped file error: failed to map " + path.string());
+    }
+
+    length = size;
+}
+
+void MappedFile::close() {
+    if (ptr != nullptr) {
+        UnmapViewOfFile(ptr);
+        ptr = nullptr;
+    }
+    if (mapping != nullptr) {
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+    if (file != nullptr) {
+        CloseHandle(file);
+        file = nullptr;
+    }
+    length = 0;
+}
+
+void MappedFile::flush() {
+    flush(0, length);
+}
+
+// Returns once the range is on disk, not just handed to the OS
+void MappedFile::flush(size_t offset, size_t bytes) {
+    if (ptr != nullptr && bytes > 0) {
+        FlushViewOfFile(ptr + offset, bytes);
+        FlushFileBuffers(file);
+    }
+}
+
+#else
+
+void MappedFile::open(const fs::path& path, size_t size) {
+    close();
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Mapped file error: failed to open " + path.string());
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close();
+        throw std::runtime_error("Mapped file error: failed to resize " + path.string());
+    }
+
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        close();
+        throw std::runtime_error("Mapped file error: failed to map " + path.string());
+    }
+
+    ptr = static_cast<uint8_t*>(addr);
+    length = size;
+}
+
+void MappedFile::close() {
+    if (ptr != nullptr) {
+        munmap(ptr, length);
+        ptr = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    length = 0;
+}
+
+void MappedFile::flush() {
+    flush(0, length);
+}
+
+// Returns once the range is on disk, not just handed to the OS
+void MappedFile::flush(size_t offset, size_t bytes) {
+    if (ptr == nullptr || bytes == 0) {
+        return;
+    }
+
+    // msync wants a page aligned address
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t start = offset / pageSize * pageSize;
+    msync(ptr + start, offset + bytes - start, MS_SYNC);
+}
+
+#endif
+
+} // namespace Cache
@@ -0,0 +1,138 @@
+#include <extlib/cache/probeindex.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <plog/Log.h>
+
+namespace Cache {
+
+constexpr char PROBE_INDEX_MAGIC[4] = { 'A', 'A', 'P', 'I' };
+constexpr uint32_t PROBE_INDEX_VERSION = 2;
+constexpr size_t PROBE_INDEX_MAX_KEY = 4096;
+
+// A missing or unreadable index just means every file gets probed again
+void ProbeIndex::load(fs::path path) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->path = path;
+    entries.clear();
+
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.is_open()) {
+        return;
+    }
+
+    char magic[4];
+    uint32_t version, count;
+
+    stream.read(magic, sizeof(magic));
+    stream.read(reinterpret_cast<char*>(&version), sizeof(version));
+    stream.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+    if (!stream || std::memcmp(magic, PROBE_INDEX_MAGIC, sizeof(magic)) != 0 || version != PROBE_INDEX_VERSION) {
+        PLOG_WARNING << "Ignoring probe index " << path;
+        return;
+    }
+
+    std::string key;
+    ProbeEntry entry;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t keySize;
+        stream.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
+        if (!stream || keySize > PROBE_INDEX_MAX_KEY) {
+            break;
+        }
+
+        key.resize(keySize);
+        stream.read(key.data(), keySize);
+        stream.read(reinterpret_cast<char*>(&entry), sizeof(entry));
+        if (!stream) {
+            break;
+        }
+
+        entries[key] = entry;
+    }
+
+    PLOG_DEBUG << "Loaded " << entries.size() << " probe index entries";
+}
+
+// Writes to a temporary file first, so a crash never leaves half an index behind
+void ProbeIndex::save() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!dirty || path.empty()) {
+        return;
+    }
+
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+
+    {
+        std::ofstream stream(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!stream.is_open()) {
+            PLOG_WARNING << "Could not write probe index " << tmpPath;
+            return;
+        }
+
+        uint32_t count = entries.size();
+        stream.write(PROBE_INDEX_MAGIC, sizeof(PROBE_INDEX_MAGIC));
+        stream.write(reinterpret_cast<const char*>(&PROBE_INDEX_VERSION), sizeof(PROBE_INDEX_VERSION));
+        stream.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+        for (const auto& [ key, entry ] : entries) {
+            uint32_t keySize = key.size();
+            stream.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+            stream.write(key.data(), keySize);
+            stream.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        }
+
+        if (!stream) {
+            PLOG_WARNING << "Could not write probe index " << tmpPath;
+            return;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+
+    if (ec) {
+        PLOG_WARNING << "Could not write probe index " << path << ": " << ec.message();
+        return;
+    }
+
+    dirty = false;
+}
+
+bool ProbeIndex::find(const std::string& key, const Vfs::File& file, ProbeEntry& entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = entries.find(key);
+    if (it == entries.end() || it->second.size != file.size() || it->second.fingerprint != file.fingerprint()) {
+        return false;
+    }
+
+    if (it->second.chunkFrames == 0 || it->second.trackCount == 0) {
+        return false;
+    }
+
+    entry = it->second;
+    return true;
+}
+
+void ProbeIndex::store(const std::string& key, const Vfs::File& file, ProbeEntry entry) {
+    if (key.size() > PROBE_INDEX_MAX_KEY) {
+        return;
+    }
+
+    entry.size = file.size();
+    entry.fingerprint = file.fingerprint();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[key] = entry;
+    dirty = true;
+}
+
+} // namespace Cache
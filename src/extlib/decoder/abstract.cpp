@@ -12,6 +12,7 @@
 #include <extlib/decoder/mp3.hpp>
 #include <extlib/decoder/vorbis.hpp>
 #include <extlib/decoder/opus.hpp>
+#include <extlib/decoder/pack.hpp>
 
 namespace Decoder {
 
@@ -93,6 +94,8 @@ std::unique_ptr<Abstract> factory(std::shared_ptr<Vfs::File> file, Type type) {
             type = Type::Opus;
         } else if (ext == ".ogg") {
             type = getOggType(file);
+        } else if (ext == ".apcm") {
+            type = Type::Pack;
         } else {
             throw std::runtime_error("Decoder error: unknown file extension: " + ext);
         }
@@ -109,9 +112,28 @@ std::unique_ptr<Abstract> factory(std::shared_ptr<Vfs::File> file, Type type) {
         return std::make_unique<Vorbis>(file);
     case Type::Opus:
         return std::make_unique<Opus>(file);
+    case Type::Pack:
+        return std::make_unique<Pack>(file);
     default:
         throw std::runtime_error("Decoder error: uknown decoder type");
     }
 }
 
+// Creates a second decoder for the same stream reading through the given handle. Metadata is shared
+// and has already been read, so the copy skips parsing it again.
+std::unique_ptr<Abstract> Abstract::clone(std::shared_ptr<Vfs::File> file) {
+    auto copy = factory(file, type());
+    copy->metadata = metadata;
+    copy->firstOpen = false;
+    copy->chunkFrames = chunkFrames;
+    return copy;
+}
+
+// Takes over metadata probed in an earlier session, so opening skips parsing it again
+void Abstract::restore(std::shared_ptr<Metadata> metadata, size_t chunkFrames) {
+    this->metadata = metadata;
+    this->firstOpen = false;
+    this->chunkFrames = chunkFrames;
+}
+
 } // namespace Decoder
@@ -9,6 +9,10 @@
 
 namespace Decoder {
 
+// Marks an unused entry in a native seek table
+constexpr drflac_uint64 FLAC_PLACEHOLDER_POINT = 0xFFFFFFFFFFFFFFFF;
+constexpr size_t FLAC_MAX_SKIP_SECONDS = 1;
+
 void Flac::open() {
     if (decoder != nullptr) {
         return;
@@ -49,6 +53,45 @@ void Flac::probe() {
     metadata->setSampleRate(decoder->sampleRate);
     metadata->setSampleCount(decoder->totalPCMFrameCount);
     metadata->findLoopPoints();
+
+    // Assumes a fixed block size, which is what the reference encoder produces
+    chunkFrames = alignChunkSize(decoder->maxBlockSizeInPCMFrames);
+}
+
+// Takes the stream's own seek table, if it has one. dr_flac can't start decoding at a byte offset
+// of our choosing, so files without one aren't scanned for a table nothing could use.
+void Flac::index() {
+    if (decoder == nullptr) {
+        throw std::runtime_error("Decoder error: not open");
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    metadata->seekIndex.build([this] {
+        return nativeSeekPoints;
+    });
+}
+
+// dr_flac seeks with the stream's own seek table, and bisects the file without one. A target in the
+// same stretch between seek points as the decoder, or close enough ahead of it, is reached by
+// decoding forward instead. Caller must hold the lock.
+void Flac::seek(size_t offset) {
+    size_t current = pos.load();
+
+    if (offset > current) {
+        const SeekPoint* point = metadata->seekIndex.find(offset);
+        if ((point != nullptr && point->frame <= current) ||
+            withinSkip(current, offset, metadata->sampleRate * FLAC_MAX_SKIP_SECONDS)) {
+            // Reading into a null buffer decodes and drops the frames
+            if (drflac_read_pcm_frames_s16(decoder, offset - current, nullptr) == offset - current) {
+                return;
+            }
+        }
+    }
+
+    if (!drflac_seek_to_pcm_frame(decoder, offset)) {
+        throw std::runtime_error("Decoder error: failed to seek to frame");
+    }
 }
 
 long Flac::decode(std::vector<int16_t>* buffer, size_t count, size_t offset) {
@@ -61,9 +104,7 @@ long Flac::decode(std::vector<int16_t>* buffer, size_t count, size_t offset) {
     size_t framesToRead = std::min(count, metadata->sampleCount - offset);
 
     if (pos.load() != offset) {
-        if (!drflac_seek_to_pcm_frame(decoder, offset)) {
-            throw std::runtime_error("Decoder error: failed to seek to frame");
-        }
+        seek(offset);
     }
 
     pos.store(offset + framesToRead);
@@ -106,6 +147,15 @@ void Flac::onMeta(void* datasrc, drflac_metadata* metadata) {
         }
         break;
     }
+    case DRFLAC_METADATA_BLOCK_TYPE_SEEKTABLE: {
+        for (drflac_uint32 i = 0; i < metadata->data.seektable.seekpointCount; i++) {
+            const auto& point = metadata->data.seektable.pSeekpoints[i];
+            if (point.firstPCMFrame != FLAC_PLACEHOLDER_POINT) {
+                that->nativeSeekPoints.push_back({ point.firstPCMFrame, point.flacFrameOffset });
+            }
+        }
+        break;
+    }
     case DRFLAC_METADATA_BLOCK_TYPE_APPLICATION: {
         if (metadata->data.application.id == 0x72696666) { // RIFF chunk storage
             drflac_uint32 size = metadata->data.application.dataSize;
@@ -9,6 +9,10 @@
 
 namespace Decoder {
 
+// Roughly one seek point every 250 ms at 44.1 kHz
+constexpr uint64_t MP3_SEEK_INTERVAL = 11025;
+constexpr uint32_t MP3_MAX_SEEK_POINTS = 4096;
+
 void Mp3::open() {
     if (decoder != nullptr) {
         return;
@@ -29,6 +33,7 @@ void Mp3::open() {
     }
 
     firstOpen = false;
+    bindSeekTable();
 }
 
 void Mp3::close() {
@@ -40,6 +45,7 @@ void Mp3::close() {
     drmp3_uninit(decoder);
     delete decoder;
     decoder = nullptr;
+    seekTableBound = false;
     pos.store(0);
 }
 
@@ -56,6 +62,67 @@ void Mp3::probe() {
     metadata->findLoopPoints();
 }
 
+// Scans every frame header once so later seeks start from a nearby frame instead of the beginning
+void Mp3::index() {
+    if (decoder == nullptr) {
+        throw std::runtime_error("Decoder error: not open");
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    bool built = false;
+
+    metadata->seekIndex.build([this, &built] {
+        drmp3_uint32 count = static_cast<drmp3_uint32>(std::clamp<uint64_t>(
+            decoder->totalPCMFrameCount / MP3_SEEK_INTERVAL, 1, MP3_MAX_SEEK_POINTS));
+        std::vector<drmp3_seek_point> table(count);
+
+        // A failed scan leaves the decoder wherever it stopped, so the next decode has to seek
+        if (!drmp3_calculate_seek_points(decoder, &count, table.data())) {
+            pos.store(SIZE_MAX);
+            throw std::runtime_error("Decoder error: failed to calculate seek points");
+        }
+        built = true;
+
+        std::vector<SeekPoint> points;
+        points.reserve(count);
+        for (drmp3_uint32 i = 0; i < count; i++) {
+            points.push_back({ table[i].pcmFrameIndex, table[i].seekPosInBytes,
+                               table[i].mp3FramesToDiscard, table[i].pcmFramesToDiscard });
+        }
+        return points;
+    });
+
+    // Calculating the seek points leaves the decoder at the start of the stream. Another decoder may
+    // have built the index already, and then this one hasn't moved.
+    if (built) {
+        pos.store(0);
+    }
+
+    bindSeekTable();
+}
+
+// Caller must hold the lock, or be the only user of the decoder
+void Mp3::bindSeekTable() {
+    if (seekTableBound || !metadata->seekIndex.ready()) {
+        return;
+    }
+
+    const auto& points = metadata->seekIndex.points();
+
+    seekTable.clear();
+    seekTable.reserve(points.size());
+    for (const auto& point : points) {
+        seekTable.push_back({ point.offset, point.frame, point.framesToDiscard, point.pcmFramesToDiscard });
+    }
+
+    if (!seekTable.empty()) {
+        drmp3_bind_seek_table(decoder, static_cast<drmp3_uint32>(seekTable.size()), seekTable.data());
+    }
+
+    seekTableBound = true;
+}
+
 long Mp3::decode(std::vector<int16_t>* buffer, size_t count, size_t offset) {
     if (decoder == nullptr) {
         throw std::runtime_error("Decoder error: not open");
@@ -66,6 +133,7 @@ long Mp3::decode(std::vector<int16_t>* buffer, size_t count, size_t offset) {
     size_t framesToRead = std::min(count, metadata->sampleCount - offset);
 
     if (pos.load() != offset) {
+        bindSeekTable();
         if (!drmp3_seek_to_pcm_frame(decoder, offset)) {
             throw std::runtime_error("Decoder error: failed to seek to frame");
         }
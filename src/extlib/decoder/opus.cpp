@@ -3,6 +3,12 @@
 
 namespace Decoder {
 
+// One second, as Opus always decodes at 48 kHz
+constexpr size_t OPUS_MAX_SKIP_FRAMES = 48000;
+
+// The decoder needs 80 ms of audio before a seek target to converge
+constexpr size_t OPUS_PREROLL_FRAMES = 3840;
+
 static const OpusFileCallbacks callbacks = {
     Opus::onRead,
     Opus::onSeek,
@@ -63,6 +69,26 @@ void Opus::probe() {
     metadata->findLoopPoints();
 }
 
+// Maps each Ogg page to the frame it starts at, so seeks can jump straight to the right page
+void Opus::index() {
+    if (decoder == nullptr) {
+        throw std::runtime_error("Decoder error: not open");
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    const OpusHead* head = op_head(decoder, -1);
+    if (head == nullptr) {
+        throw std::runtime_error("Decoder error: failed to read head");
+    }
+
+    uint64_t preSkip = head->pre_skip;
+
+    metadata->seekIndex.build([this, preSkip] {
+        return SeekIndex::scanOgg(file, preSkip);
+    });
+}
+
 long Opus::decode(std::vector<int16_t>* buffer, size_t count, size_t offset) {
     if (decoder == nullptr) {
         throw std::runtime_error("Decoder error: not open");
@@ -76,9 +102,7 @@ long Opus::decode(std::vector<int16_t>* buffer, size_t count, size_t offset) {
     int result = 0;
 
     if (pos.load() != offset) {
-        if (op_pcm_seek(decoder, offset) != 0) {
-            throw std::runtime_error("Decoder error: failed to seek to frame");
-        }
+        seek(offset);
     }
 
     while (framesRead < framesToRead) {
@@ -126,6 +150,47 @@ long Opus::decode(std::vector<int16_t>* buffer, size_t count, size_t offset) {
     return framesRead;
 }
 
+// Caller must hold the lock
+void Opus::seek(size_t offset) {
+    ogg_int64_t current = op_pcm_tell(decoder);
+
+    if (withinSkip(current, offset, OPUS_MAX_SKIP_FRAMES)) {
+        skip(offset - current);
+        return;
+    }
+
+    const SeekPoint* point = metadata->seekIndex.find(offset - std::min(offset, OPUS_PREROLL_FRAMES));
+
+    if (point != nullptr && op_raw_seek(decoder, point->offset) == 0) {
+        current = op_pcm_tell(decoder);
+        if (withinSkip(current, offset, OPUS_MAX_SKIP_FRAMES)) {
+            skip(offset - current);
+            return;
+        }
+    }
+
+    if (op_pcm_seek(decoder, offset) != 0) {
+        throw std::runtime_error("Decoder error: failed to seek to frame");
+    }
+}
+
+// Caller must hold the lock
+void Opus::skip(size_t frames) {
+    thread_local std::vector<int16_t> scratch;
+    scratch.resize(DEFAULT_CHUNK_SIZE * metadata->trackCount);
+
+    while (frames > 0) {
+        int framesToRead = static_cast<int>(std::min(frames, DEFAULT_CHUNK_SIZE));
+        int result = op_read(decoder, scratch.data(), framesToRead * metadata->trackCount, nullptr);
+
+        if (result <= 0) {
+            throw std::runtime_error("Decoder error: failed to seek to frame");
+        }
+
+        frames -= result;
+    }
+}
+
 int Opus::onRead(void* datasrc, unsigned char* ptr, int bytes) {
     auto that = static_cast<Opus*>(datasrc);
     return that->file->read(ptr, bytes);
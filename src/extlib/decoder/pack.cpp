@@ -0,0 +1,129 @@
+#include <extlib/decoder/pack.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <extlib/utils.hpp>
+
+namespace Decoder {
+
+static void write_u32_be(uint8_t* p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+bool PackHeader::parse(const uint8_t* data) {
+    if (std::memcmp(data, "APCM", 4) != 0 || read_u32_be(data + 0x04) != PACK_VERSION) {
+        return false;
+    }
+
+    trackCount  = read_u32_be(data + 0x08);
+    sampleRate  = read_u32_be(data + 0x0C);
+    sampleCount = read_u32_be(data + 0x10);
+    loopStart   = read_u32_be(data + 0x14);
+    loopEnd     = read_u32_be(data + 0x18);
+    loopCount   = static_cast<int32_t>(read_u32_be(data + 0x1C));
+    dataOffset  = read_u32_be(data + 0x20);
+    planeStride = read_u32_be(data + 0x24);
+
+    return trackCount > 0 && dataOffset >= PACK_HEADER_SIZE &&
+           static_cast<uint64_t>(planeStride) >= static_cast<uint64_t>(sampleCount) * sizeof(int16_t);
+}
+
+void PackHeader::serialize(uint8_t* data) const {
+    std::memset(data, 0, PACK_HEADER_SIZE);
+    std::memcpy(data, "APCM", 4);
+    write_u32_be(data + 0x04, PACK_VERSION);
+    write_u32_be(data + 0x08, trackCount);
+    write_u32_be(data + 0x0C, sampleRate);
+    write_u32_be(data + 0x10, sampleCount);
+    write_u32_be(data + 0x14, loopStart);
+    write_u32_be(data + 0x18, loopEnd);
+    write_u32_be(data + 0x1C, static_cast<uint32_t>(loopCount));
+    write_u32_be(data + 0x20, dataOffset);
+    write_u32_be(data + 0x24, planeStride);
+}
+
+void Pack::open() {
+    if (isOpen) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    uint8_t data[PACK_HEADER_SIZE];
+
+    file->seek(0, SEEK_SET);
+    if (file->read(data, sizeof(data)) != sizeof(data) || !header.parse(data)) {
+        throw std::runtime_error("Decoder error: failed to open decoder");
+    }
+
+    uint64_t end = header.dataOffset + static_cast<uint64_t>(header.trackCount) * header.planeStride;
+    if (end > file->size()) {
+        throw std::runtime_error("Decoder error: truncated pack");
+    }
+
+    isOpen = true;
+}
+
+void Pack::close() {
+    if (!isOpen) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    isOpen = false;
+    pos.store(0);
+}
+
+void Pack::probe() {
+    if (!isOpen) {
+        throw std::runtime_error("Decoder error: not open");
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    metadata->setTrackCount(header.trackCount);
+    metadata->setSampleRate(header.sampleRate);
+    metadata->setSampleCount(header.sampleCount);
+    metadata->setLoopInfo(header.loopStart, header.loopEnd, header.loopCount);
+}
+
+// No decoding, just a bounds checked read of each plane, interleaved into the output
+long Pack::decode(std::vector<int16_t>* buffer, size_t count, size_t offset) {
+    if (!isOpen) {
+        throw std::runtime_error("Decoder error: not open");
+    }
+    if (offset >= header.sampleCount) {
+        throw std::runtime_error("Decoder error: failed to seek to frame");
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    thread_local std::vector<uint8_t> plane;
+
+    size_t framesToRead = std::min<size_t>(count, header.sampleCount - offset);
+    size_t trackCount = header.trackCount;
+    plane.resize(framesToRead * sizeof(int16_t));
+
+    for (size_t trackNo = 0; trackNo < trackCount; trackNo++) {
+        file->seek(header.dataOffset + trackNo * header.planeStride + offset * sizeof(int16_t), SEEK_SET);
+
+        if (file->read(plane.data(), plane.size()) != plane.size()) {
+            throw std::runtime_error("Decoder error: truncated pack");
+        }
+
+        int16_t* out = buffer->data() + trackNo;
+        for (size_t i = 0; i < framesToRead; i++) {
+            out[i * trackCount] = static_cast<int16_t>((plane[i * 2] << 8) | plane[i * 2 + 1]);
+        }
+    }
+
+    pos.store(offset + framesToRead);
+
+    return framesToRead;
+}
+
+} // namespace Decoder
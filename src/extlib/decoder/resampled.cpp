@@ -0,0 +1,159 @@
+#include <extlib/decoder/resampled.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace Decoder {
+
+void Resampled::open() {
+    inner->open();
+
+    // Restored from the probe index, only the output side of the metadata is known yet. Otherwise
+    // probe() is about to be called anyway.
+    if (!firstOpen && inner->metadata->sampleRate == 0) {
+        inner->probe();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    setup();
+}
+
+void Resampled::close() {
+    inner->close();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    sourceFrames = 0;
+    pos.store(0);
+}
+
+// Caller must hold mutex. Waits until the source rate is known.
+void Resampled::setup() {
+    uint32_t sourceRate = inner->metadata->sampleRate;
+
+    if (configured || sourceRate == 0) {
+        return;
+    }
+
+    passthrough = sourceRate == outputRate || !resampler.init(sourceRate, outputRate);
+    configured = true;
+}
+
+void Resampled::probe() {
+    inner->probe();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    setup();
+
+    const Metadata& src = *inner->metadata;
+
+    metadata->trackCount = src.trackCount;
+    metadata->loopCount = src.loopCount;
+
+    if (passthrough) {
+        metadata->sampleRate = src.sampleRate;
+        metadata->sampleCount = src.sampleCount;
+        metadata->loopStart = src.loopStart;
+        metadata->loopEnd = src.loopEnd;
+        chunkFrames = inner->chunkSize();
+        return;
+    }
+
+    // Codec frames mean nothing at the output rate, so chunks go back to the default size
+    metadata->sampleRate = outputRate;
+    metadata->sampleCount = resampler.outputLength(src.sampleCount);
+    metadata->loopStart = std::min<uint64_t>(resampler.outputFrame(src.loopStart), metadata->sampleCount);
+    metadata->loopEnd = std::min<uint64_t>(resampler.outputFrame(src.loopEnd), metadata->sampleCount);
+    chunkFrames = DEFAULT_CHUNK_SIZE;
+}
+
+// Caller must hold mutex. Leaves source frames [start, end) of the stream in source, as far as
+// they exist. Frames already there from the previous call are kept, and the rest are read from
+// where that call stopped, so the wrapped decoder keeps reading forward.
+void Resampled::fill(int64_t start, int64_t end) {
+    size_t trackCount = inner->metadata->trackCount;
+    int64_t first = std::max<int64_t>(start, 0);
+    int64_t last = std::min<int64_t>(end, inner->metadata->sampleCount);
+
+    if (first >= last) {
+        sourceStart = first;
+        sourceFrames = 0;
+        return;
+    }
+
+    size_t frames = last - first;
+    size_t kept = 0;
+    int64_t cachedEnd = sourceStart + static_cast<int64_t>(sourceFrames);
+
+    if (source.size() < frames * trackCount) {
+        source.resize(frames * trackCount);
+    }
+
+    if (sourceFrames > 0 && first >= sourceStart && first < cachedEnd) {
+        kept = std::min(cachedEnd, last) - first;
+        std::memmove(source.data(), source.data() + (first - sourceStart) * trackCount,
+                     kept * trackCount * sizeof(int16_t));
+    }
+
+    sourceStart = first;
+    sourceFrames = kept;
+
+    if (kept < frames) {
+        size_t count = frames - kept;
+        scratch.resize(count * trackCount);
+
+        long framesRead = inner->decode(&scratch, count, first + kept);
+        std::memcpy(source.data() + kept * trackCount, scratch.data(), framesRead * trackCount * sizeof(int16_t));
+        sourceFrames += framesRead;
+    }
+}
+
+long Resampled::decode(std::vector<int16_t>* buffer, size_t count, size_t offset) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (passthrough) {
+        lock.unlock();
+        long framesRead = inner->decode(buffer, count, offset);
+        pos.store(offset + framesRead);
+        return framesRead;
+    }
+
+    if (offset >= metadata->sampleCount) {
+        throw std::runtime_error("Decoder error: failed to seek to frame");
+    }
+
+    size_t framesToRead = std::min<size_t>(count, metadata->sampleCount - offset);
+    size_t trackCount = metadata->trackCount;
+    int64_t start = resampler.windowStart(offset);
+    int64_t end = resampler.windowEnd(offset, framesToRead);
+
+    fill(start, end);
+
+    // Frames before the start or past the end of the stream read as silence
+    int64_t sourceEnd = sourceStart + static_cast<int64_t>(sourceFrames);
+    plane.resize(end - start);
+
+    for (size_t trackNo = 0; trackNo < trackCount; trackNo++) {
+        for (int64_t i = start; i < end; i++) {
+            plane[i - start] = (i >= sourceStart && i < sourceEnd)
+                ? source[(i - sourceStart) * trackCount + trackNo]
+                : 0.0f;
+        }
+
+        resampler.process(buffer->data() + trackNo, trackCount, plane.data(), start, offset, framesToRead);
+    }
+
+    pos.store(offset + framesToRead);
+
+    return framesToRead;
+}
+
+// The wrapped decoder is cloned along with the wrapper, sharing the source side metadata
+std::unique_ptr<Abstract> Resampled::clone(std::shared_ptr<Vfs::File> file) {
+    auto copy = std::make_unique<Resampled>(file, inner->clone(file), outputRate);
+    copy->metadata = metadata;
+    copy->firstOpen = false;
+    copy->chunkFrames = chunkFrames;
+    return copy;
+}
+
+} // namespace Decoder
@@ -0,0 +1,98 @@
+#include <extlib/decoder/seekindex.hpp>
+
+#include <algorithm>
+
+#include <ogg/ogg.h>
+
+namespace Decoder {
+
+constexpr size_t SCAN_BUFFER_SIZE = 64 * 1024;
+
+void SeekIndex::build(const std::function<std::vector<SeekPoint>()>& fn) {
+    // If fn throws, the flag stays unset and the next caller tries again
+    std::call_once(once, [&] {
+        seekPoints = fn();
+        isReady.store(true, std::memory_order_release);
+    });
+}
+
+// Returns the last point at or before frame, if any
+const SeekPoint* SeekIndex::find(uint64_t frame) const {
+    if (!ready()) {
+        return nullptr;
+    }
+
+    auto it = std::upper_bound(seekPoints.begin(), seekPoints.end(), frame, [](uint64_t frame, const auto& point) {
+        return frame < point.frame;
+    });
+
+    return it == seekPoints.begin() ? nullptr : &*(it - 1);
+}
+
+// Maps every page of the first logical stream to the PCM frame that decoding from it starts at,
+// which is where the previous page ended. Reads through the decoder's own open handle, so a zip
+// entry isn't inflated twice, and puts its position back for the decoder.
+std::vector<SeekPoint> SeekIndex::scanOgg(std::shared_ptr<Vfs::File> file, uint64_t granuleOffset) {
+    ogg_sync_state oy{};
+    ogg_page og;
+    std::vector<SeekPoint> points;
+
+    int64_t pageOffset = 0;
+    int64_t lastGranule = -1;
+    int serialNo = 0;
+    bool firstPage = true;
+
+    int64_t resumeAt = file->tell();
+    file->seek(0, SEEK_SET);
+    ogg_sync_init(&oy);
+
+    try {
+        while (true) {
+            long result = ogg_sync_pageseek(&oy, &og);
+
+            if (result < 0) {
+                pageOffset -= result;
+                continue;
+            }
+
+            if (result == 0) {
+                char* buffer = ogg_sync_buffer(&oy, SCAN_BUFFER_SIZE);
+                size_t bytesRead = file->read(buffer, SCAN_BUFFER_SIZE);
+                if (bytesRead == 0) {
+                    break;
+                }
+                ogg_sync_wrote(&oy, bytesRead);
+                continue;
+            }
+
+            if (firstPage) {
+                serialNo = ogg_page_serialno(&og);
+                firstPage = false;
+            }
+
+            int64_t granule = ogg_page_granulepos(&og);
+
+            if (ogg_page_serialno(&og) == serialNo && granule >= 0) {
+                if (lastGranule > 0) {
+                    uint64_t frame = static_cast<uint64_t>(lastGranule);
+                    points.push_back({ frame > granuleOffset ? frame - granuleOffset : 0,
+                                       static_cast<uint64_t>(pageOffset) });
+                }
+                lastGranule = granule;
+            }
+
+            pageOffset += result;
+        }
+    } catch (...) {
+        ogg_sync_clear(&oy);
+        file->seek(resumeAt, SEEK_SET);
+        throw;
+    }
+
+    ogg_sync_clear(&oy);
+    file->seek(resumeAt, SEEK_SET);
+
+    return points;
+}
+
+} // namespace Decoder
@@ -3,6 +3,8 @@
 
 namespace Decoder {
 
+constexpr size_t VORBIS_MAX_SKIP_SECONDS = 1;
+
 static const ov_callbacks callbacks = {
     Vorbis::onRead,
     Vorbis::onSeek,
@@ -63,6 +65,19 @@ void Vorbis::probe() {
     metadata->findLoopPoints();
 }
 
+// Maps each Ogg page to the frame it starts at, so seeks can jump straight to the right page
+void Vorbis::index() {
+    if (decoder == nullptr) {
+        throw std::runtime_error("Decoder error: not open");
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    metadata->seekIndex.build([this] {
+        return SeekIndex::scanOgg(file, 0);
+    });
+}
+
 long Vorbis::decode(std::vector<int16_t>* buffer, size_t count, size_t offset) {
     if (decoder == nullptr) {
         throw std::runtime_error("Decoder error: not open");
@@ -76,12 +91,9 @@ long Vorbis::decode(std::vector<int16_t>* buffer, size_t count, size_t offset) {
     long result = 0;
 
     if (pos.load() != offset) {
-        if (ov_pcm_seek(decoder, offset) != 0) {
-            throw std::runtime_error("Decoder error: failed to seek to frame");
-        }
+        seek(offset);
     }
 
-
     while (framesRead < framesToRead) {
         result = ov_read(decoder, reinterpret_cast<char*>(ptr + framesRead * metadata->trackCount),
                          (framesToRead - framesRead) * metadata->trackCount * sizeof(int16_t), 0, 2, 1, &bitstream);
@@ -111,6 +123,49 @@ long Vorbis::decode(std::vector<int16_t>* buffer, size_t count, size_t offset) {
     return framesRead;
 }
 
+// Caller must hold the lock
+void Vorbis::seek(size_t offset) {
+    size_t maxSkip = metadata->sampleRate * VORBIS_MAX_SKIP_SECONDS;
+    ogg_int64_t current = ov_pcm_tell(decoder);
+
+    if (withinSkip(current, offset, maxSkip)) {
+        skip(offset - current);
+        return;
+    }
+
+    const SeekPoint* point = metadata->seekIndex.find(offset);
+
+    if (point != nullptr && ov_raw_seek(decoder, point->offset) == 0) {
+        current = ov_pcm_tell(decoder);
+        if (withinSkip(current, offset, maxSkip)) {
+            skip(offset - current);
+            return;
+        }
+    }
+
+    if (ov_pcm_seek(decoder, offset) != 0) {
+        throw std::runtime_error("Decoder error: failed to seek to frame");
+    }
+}
+
+// Caller must hold the lock
+void Vorbis::skip(size_t frames) {
+    thread_local std::vector<int16_t> scratch;
+    scratch.resize(DEFAULT_CHUNK_SIZE * metadata->trackCount);
+
+    while (frames > 0) {
+        size_t framesToRead = std::min(frames, DEFAULT_CHUNK_SIZE);
+        long result = ov_read(decoder, reinterpret_cast<char*>(scratch.data()),
+                              framesToRead * metadata->trackCount * sizeof(int16_t), 0, 2, 1, &bitstream);
+
+        if (result <= 0) {
+            throw std::runtime_error("Decoder error: failed to seek to frame");
+        }
+
+        frames -= result / (metadata->trackCount * sizeof(int16_t));
+    }
+}
+
 size_t Vorbis::onRead(void* ptr, size_t size, size_t nmemb, void* datasrc) {
     auto that = static_cast<Vorbis*>(datasrc);
     size_t bytesRead = that->file->read(ptr, size * nmemb);
@@ -0,0 +1,303 @@
+#include <extlib/dsp/pcm.hpp>
+
+#include <cstring>
+
+#include <mod_recomp.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DSP_X86_64
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define DSP_AARCH64
+#include <arm_neon.h>
+#endif
+
+namespace Dsp {
+
+// Every kernel writes whole pairs of samples at a time, then leaves the tail to the scalar loop.
+// Since the tail always starts on an even frame, plane[i ^ 1] still lands in the right slot.
+
+template <size_t N>
+static void deinterleaveScalar(int16_t* plane, const int16_t* src, size_t frames, size_t trackNo) {
+    for (size_t i = 0; i < frames; i++) {
+        plane[i ^ 1] = src[i * N + trackNo];
+    }
+}
+
+#ifdef DSP_X86_64
+
+// Returns the samples of trackNo for 4 frames, sign extended to 32 bits. With 8 tracks, the half of
+// each frame that holds trackNo is picked first, which reduces it to the 4 track case.
+template <size_t N, bool High>
+static inline __m128i gatherSse2(const int16_t* src, __m128i shift) {
+    auto load = [src](size_t i) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + i);
+    };
+
+    if constexpr (N == 2) {
+        return _mm_srai_epi32(_mm_sll_epi32(load(0), shift), 16);
+    } else {
+        __m128i a, b;
+
+        if constexpr (N == 4) {
+            a = load(0);
+            b = load(1);
+        } else if constexpr (High) {
+            a = _mm_unpackhi_epi64(load(0), load(1));
+            b = _mm_unpackhi_epi64(load(2), load(3));
+        } else {
+            a = _mm_unpacklo_epi64(load(0), load(1));
+            b = _mm_unpacklo_epi64(load(2), load(3));
+        }
+
+        __m128 x = _mm_castsi128_ps(_mm_srai_epi32(_mm_sll_epi64(a, shift), 16));
+        __m128 y = _mm_castsi128_ps(_mm_srai_epi32(_mm_sll_epi64(b, shift), 16));
+        return _mm_castps_si128(_mm_shuffle_ps(x, y, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+}
+
+template <size_t N, bool High>
+static void deinterleaveSse2(int16_t* plane, const int16_t* src, size_t frames, size_t trackNo) {
+    // Moves the wanted sample into the top halfword of its 32-bit (N = 2) or 64-bit (N >= 4) lane
+    const __m128i shift = _mm_cvtsi32_si128(N == 2 ? 16 * (1 - trackNo) : 16 * (3 - (trackNo & 3)));
+    size_t i = 0;
+
+    for (; i + 8 <= frames; i += 8) {
+        __m128i out;
+
+        if constexpr (N == 1) {
+            out = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        } else {
+            out = _mm_packs_epi32(gatherSse2<N, High>(src + i * N, shift),
+                                  gatherSse2<N, High>(src + (i + 4) * N, shift));
+        }
+
+        out = _mm_shufflelo_epi16(out, _MM_SHUFFLE(2, 3, 0, 1));
+        out = _mm_shufflehi_epi16(out, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(plane + i), out);
+    }
+
+    deinterleaveScalar<N>(plane + i, src + i * N, frames - i, trackNo);
+}
+
+template <size_t N>
+static void deinterleaveSse2(int16_t* plane, const int16_t* src, size_t frames, size_t trackNo) {
+    if (trackNo >= 4) {
+        return deinterleaveSse2<N, true>(plane, src, frames, trackNo);
+    }
+    return deinterleaveSse2<N, false>(plane, src, frames, trackNo);
+}
+
+#define DSP_AVX2 __attribute__((target("avx2")))
+
+// Builds the per-lane byte shuffle that moves trackNo of each frame into place. For N < 8 the
+// selected samples come out already swapped into pairs, packed into the low end of the lane.
+template <size_t N>
+DSP_AVX2 static inline __m256i shuffleMaskAvx2(size_t trackNo) {
+    alignas(32) int8_t mask[32];
+    constexpr size_t framesPerLane = 8 / N;
+
+    for (size_t lane = 0; lane < 2; lane++) {
+        for (size_t i = 0; i < 16; i++) {
+            size_t j = i / 2;
+            size_t frame = j ^ 1;
+            mask[lane * 16 + i] = (framesPerLane > 1 && frame < framesPerLane) || (framesPerLane == 1 && j == 0)
+                ? static_cast<int8_t>((framesPerLane > 1 ? frame * N + trackNo : trackNo) * 2 + (i & 1))
+                : static_cast<int8_t>(0x80);
+        }
+    }
+
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(mask));
+}
+
+template <size_t N>
+DSP_AVX2 static void deinterleaveAvx2(int16_t* plane, const int16_t* src, size_t frames, size_t trackNo) {
+    const __m256i mask = shuffleMaskAvx2<N>(trackNo);
+    size_t i = 0;
+
+    auto load = [&mask](const int16_t* p, size_t n) DSP_AVX2 {
+        return _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p) + n), mask);
+    };
+
+    for (; i + 16 <= frames; i += 16) {
+        const int16_t* p = src + i * N;
+        __m256i out;
+
+        if constexpr (N == 1) {
+            out = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            out = _mm256_shufflelo_epi16(out, _MM_SHUFFLE(2, 3, 0, 1));
+            out = _mm256_shufflehi_epi16(out, _MM_SHUFFLE(2, 3, 0, 1));
+        } else if constexpr (N == 2) {
+            // Each lane yields 4 samples
+            out = _mm256_unpacklo_epi64(load(p, 0), load(p, 1));
+            out = _mm256_permute4x64_epi64(out, _MM_SHUFFLE(3, 1, 2, 0));
+        } else if constexpr (N == 4) {
+            // Each lane yields one pair, with even pairs in the low lane and odd pairs in the high lane
+            __m256i a = _mm256_unpacklo_epi32(load(p, 0), load(p, 1));
+            __m256i b = _mm256_unpacklo_epi32(load(p, 2), load(p, 3));
+            out = _mm256_unpacklo_epi64(a, b);
+            out = _mm256_permutevar8x32_epi32(out, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        } else {
+            // Each lane yields one sample, with even frames in the low lane and odd frames in the high lane
+            __m256i a = _mm256_unpacklo_epi32(_mm256_unpacklo_epi16(load(p, 0), load(p, 1)),
+                                              _mm256_unpacklo_epi16(load(p, 2), load(p, 3)));
+            __m256i b = _mm256_unpacklo_epi32(_mm256_unpacklo_epi16(load(p, 4), load(p, 5)),
+                                              _mm256_unpacklo_epi16(load(p, 6), load(p, 7)));
+            __m256i w = _mm256_unpacklo_epi64(a, b);
+            __m128i even = _mm256_castsi256_si128(w);
+            __m128i odd = _mm256_extracti128_si256(w, 1);
+            out = _mm256_set_m128i(_mm_unpackhi_epi16(odd, even), _mm_unpacklo_epi16(odd, even));
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(plane + i), out);
+    }
+
+    deinterleaveSse2<N>(plane + i, src + i * N, frames - i, trackNo);
+}
+
+#endif // DSP_X86_64
+
+#ifdef DSP_AARCH64
+
+template <size_t N>
+static void deinterleaveNeon(int16_t* plane, const int16_t* src, size_t frames, size_t trackNo) {
+    size_t i = 0;
+
+    for (; i + 8 <= frames; i += 8) {
+        int16x8_t out;
+
+        if constexpr (N == 1) {
+            out = vld1q_s16(src + i);
+        } else if constexpr (N == 2) {
+            out = vld2q_s16(src + i * N).val[trackNo];
+        } else if constexpr (N == 4) {
+            out = vld4q_s16(src + i * N).val[trackNo];
+        } else {
+            // Each vld4 lane alternates between trackNo and trackNo + 4 of the same frame
+            int16x8_t a = vld4q_s16(src + i * N).val[trackNo & 3];
+            int16x8_t b = vld4q_s16(src + i * N + 32).val[trackNo & 3];
+            out = trackNo >= 4 ? vuzp2q_s16(a, b) : vuzp1q_s16(a, b);
+        }
+
+        vst1q_s16(plane + i, vrev32q_s16(out));
+    }
+
+    deinterleaveScalar<N>(plane + i, src + i * N, frames - i, trackNo);
+}
+
+#endif // DSP_AARCH64
+
+template <template <size_t> class K>
+static DeinterleaveFn selectTrackCount(size_t trackCount) {
+    switch (trackCount) {
+    case 1: return K<1>::fn;
+    case 2: return K<2>::fn;
+    case 4: return K<4>::fn;
+    case 8: return K<8>::fn;
+    default: return nullptr;
+    }
+}
+
+template <size_t N> struct ScalarKernel { static constexpr DeinterleaveFn fn = deinterleaveScalar<N>; };
+#ifdef DSP_X86_64
+template <size_t N> struct Sse2Kernel { static constexpr DeinterleaveFn fn = deinterleaveSse2<N>; };
+template <size_t N> struct Avx2Kernel { static constexpr DeinterleaveFn fn = deinterleaveAvx2<N>; };
+#endif
+#ifdef DSP_AARCH64
+template <size_t N> struct NeonKernel { static constexpr DeinterleaveFn fn = deinterleaveNeon<N>; };
+#endif
+
+Isa bestIsa() {
+#if defined(DSP_X86_64)
+#if defined(__GNUC__) || defined(__clang__)
+    if (__builtin_cpu_supports("avx2")) {
+        return Isa::Avx2;
+    }
+#endif
+    return Isa::Sse2;
+#elif defined(DSP_AARCH64)
+    return Isa::Neon;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+    case Isa::Scalar: return "scalar";
+    case Isa::Sse2:   return "sse2";
+    case Isa::Avx2:   return "avx2";
+    case Isa::Neon:   return "neon";
+    default:          return "unknown";
+    }
+}
+
+DeinterleaveFn deinterleaveKernel(Isa isa, size_t trackCount) {
+    switch (isa) {
+    case Isa::Scalar:
+        return selectTrackCount<ScalarKernel>(trackCount);
+#ifdef DSP_X86_64
+    case Isa::Sse2:
+        return selectTrackCount<Sse2Kernel>(trackCount);
+    case Isa::Avx2:
+        return bestIsa() == Isa::Avx2 ? selectTrackCount<Avx2Kernel>(trackCount) : nullptr;
+#endif
+#ifdef DSP_AARCH64
+    case Isa::Neon:
+        return selectTrackCount<NeonKernel>(trackCount);
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+void deinterleave(int16_t* plane, const int16_t* src, size_t frames, size_t trackCount, size_t trackNo) {
+    static const Isa isa = bestIsa();
+
+    if (auto kernel = deinterleaveKernel(isa, trackCount)) {
+        return kernel(plane, src, frames, trackNo);
+    }
+
+    for (size_t i = 0; i < frames; i++) {
+        plane[i ^ 1] = src[i * trackCount + trackNo];
+    }
+}
+
+void copyToRdram(uint8_t* rdram, int32_t ptr, const int16_t* plane, size_t start, size_t count) {
+    size_t i = 0;
+
+    if (count == 0) {
+        return;
+    }
+
+    // Block copies are only possible when the plane and rdram agree on which sample of a pair comes first
+    if (((static_cast<uint32_t>(ptr) >> 1) & 1) != (start & 1)) {
+        for (; i < count; i++) {
+            MEM_H(ptr, i * 2) = plane[(start + i) ^ 1];
+        }
+        return;
+    }
+
+    if (start & 1) {
+        MEM_H(ptr, 0) = plane[start ^ 1];
+        i++;
+    }
+
+    size_t pairs = (count - i) / 2;
+    if (pairs > 0) {
+        std::memcpy(&MEM_H(ptr, i * 2 + 2), plane + start + i, pairs * 2 * sizeof(int16_t));
+        i += pairs * 2;
+    }
+
+    if (i < count) {
+        MEM_H(ptr, i * 2) = plane[(start + i) ^ 1];
+    }
+}
+
+void fillRdram(uint8_t* rdram, int32_t ptr, int16_t value, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        MEM_H(ptr, i * 2) = value;
+    }
+}
+
+} // namespace Dsp
@@ -0,0 +1,173 @@
+#include <extlib/dsp/resampler.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <numeric>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DSP_X86_64
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define DSP_AARCH64
+#include <arm_neon.h>
+#endif
+
+namespace Dsp {
+
+constexpr size_t HALF_TAPS = Resampler::TAPS / 2;
+
+// Kaiser window shape, about 60 dB of stopband attenuation
+constexpr double KAISER_BETA = 6.0;
+
+// Passband as a fraction of the lower Nyquist rate, leaves room for the transition band so
+// little aliases back below it
+constexpr double ROLLOFF = 0.88;
+
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+
+    return sum;
+}
+
+#if defined(DSP_X86_64)
+
+static inline float dot(const float* h, const float* x) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+
+    for (size_t k = 0; k < Resampler::TAPS; k += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(h + k),    _mm_loadu_ps(x + k)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(h + k + 4), _mm_loadu_ps(x + k + 4)));
+    }
+
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(acc);
+}
+
+#elif defined(DSP_AARCH64)
+
+static inline float dot(const float* h, const float* x) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+
+    for (size_t k = 0; k < Resampler::TAPS; k += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(h + k),     vld1q_f32(x + k));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(h + k + 4), vld1q_f32(x + k + 4));
+    }
+
+    return vaddvq_f32(vaddq_f32(acc0, acc1));
+}
+
+#else
+
+static inline float dot(const float* h, const float* x) {
+    float acc = 0.0f;
+
+    for (size_t k = 0; k < Resampler::TAPS; k++) {
+        acc += h[k] * x[k];
+    }
+
+    return acc;
+}
+
+#endif
+
+bool Resampler::init(uint32_t inputRate, uint32_t outputRate) {
+    if (inputRate == 0 || outputRate == 0) {
+        return false;
+    }
+
+    uint32_t div = std::gcd(inputRate, outputRate);
+    up = outputRate / div;
+    down = inputRate / div;
+
+    if (up > MAX_PHASES) {
+        return false;
+    }
+
+    // Cutoff in cycles per input frame, below whichever of the two rates is lower
+    double cutoff = 0.5 * ROLLOFF * std::min(1.0, static_cast<double>(up) / down);
+    double norm = besselI0(KAISER_BETA);
+
+    coeffs.assign(static_cast<size_t>(up) * TAPS, 0.0f);
+
+    for (uint32_t phase = 0; phase < up; phase++) {
+        double frac = static_cast<double>(phase) / up;
+        float* h = coeffs.data() + static_cast<size_t>(phase) * TAPS;
+        double sum = 0.0;
+        double taps[TAPS];
+
+        for (size_t k = 0; k < TAPS; k++) {
+            // Distance of tap k from the output frame, in input frames
+            double d = static_cast<double>(k) - (HALF_TAPS - 1) - frac;
+            double x = 2.0 * cutoff * d;
+            double sinc = x == 0.0 ? 1.0 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+            double w = d / HALF_TAPS;
+            double window = std::abs(w) >= 1.0 ? 0.0 : besselI0(KAISER_BETA * std::sqrt(1.0 - w * w)) / norm;
+
+            taps[k] = sinc * window;
+            sum += taps[k];
+        }
+
+        // Unity gain at DC for every phase, so a constant input comes out constant
+        for (size_t k = 0; k < TAPS; k++) {
+            h[k] = static_cast<float>(taps[k] / sum);
+        }
+    }
+
+    return true;
+}
+
+int64_t Resampler::windowStart(uint64_t outputFrame) const {
+    return static_cast<int64_t>(outputFrame * down / up) - static_cast<int64_t>(HALF_TAPS - 1);
+}
+
+int64_t Resampler::windowEnd(uint64_t outputFrame, size_t frames) const {
+    uint64_t last = outputFrame + (frames > 0 ? frames - 1 : 0);
+    return static_cast<int64_t>(last * down / up) + static_cast<int64_t>(HALF_TAPS) + 1;
+}
+
+uint64_t Resampler::outputLength(uint64_t inputFrames) const {
+    return (inputFrames * up + down - 1) / down;
+}
+
+uint64_t Resampler::outputFrame(uint64_t inputFrame) const {
+    return (inputFrame * up + down / 2) / down;
+}
+
+void Resampler::process(int16_t* out, size_t stride, const float* input, int64_t inputStart,
+                        uint64_t outputFrame, size_t frames) const {
+    uint64_t pos = outputFrame * down;
+    int64_t frame = static_cast<int64_t>(pos / up);
+    uint32_t phase = static_cast<uint32_t>(pos % up);
+    const uint32_t step = down / up;
+    const uint32_t stepPhase = down % up;
+
+    for (size_t n = 0; n < frames; n++) {
+        const float* x = input + (frame - static_cast<int64_t>(HALF_TAPS - 1) - inputStart);
+        float y = dot(coeffs.data() + static_cast<size_t>(phase) * TAPS, x);
+
+        out[n * stride] = static_cast<int16_t>(std::clamp(std::lrintf(y), -32768L, 32767L));
+
+        frame += step;
+        phase += stepPhase;
+        if (phase >= up) {
+            phase -= up;
+            frame++;
+        }
+    }
+}
+
+} // namespace Dsp
@@ -0,0 +1,319 @@
+#include <extlib/dsp/vadpcm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <mod_recomp.h>
+
+namespace Dsp {
+
+constexpr size_t HALF_FRAME = 8;
+constexpr int MAX_SCALE = 12;
+constexpr int DESIGN_ITERATIONS = 16;
+
+// Keeps every predictor inside the stability triangle with a little margin, so its expanded
+// coefficients stay well within 16 bits and errors die out instead of ringing
+constexpr double STABILITY_MARGIN = 0.98;
+
+using Predictor = int16_t[VadpcmBook::ORDER][HALF_FRAME];
+
+static inline int16_t clamp16(int64_t value) {
+    return static_cast<int16_t>(std::clamp<int64_t>(value, -32768, 32767));
+}
+
+// The RSP's inner loop: each sample is the residual plus what the two samples before this half
+// frame and the residuals before it in this half frame predict. The RSP sums in a wide accumulator.
+static inline int64_t predict(const Predictor& t, const int32_t* residuals, const int16_t* history, size_t i) {
+    int64_t acc = t[0][i] * history[0] + t[1][i] * history[1];
+    for (size_t j = 0; j < i; j++) {
+        acc += t[1][i - 1 - j] * static_cast<int64_t>(residuals[j]);
+    }
+    return acc;
+}
+
+// Chooses each residual of a half frame in turn against the decoder's own output, so rounding in
+// earlier samples is made up for by later ones. Returns the squared error.
+static int64_t quantizeHalf(const Predictor& t, const int16_t* in, int16_t* history, int scale,
+                            int8_t* nibbles, int16_t* out) {
+    int32_t residuals[HALF_FRAME];
+    int64_t error = 0;
+    const int64_t step = 2048 << scale;
+
+    for (size_t i = 0; i < HALF_FRAME; i++) {
+        int64_t base = predict(t, residuals, history, i);
+
+        // The RSP shifts the sum down without rounding, so aim for the middle of the sample
+        int64_t target = in[i] * 2048 + 1024 - base;
+        int64_t q = target >= 0 ? (target + step / 2) / step : -((-target + step / 2) / step);
+        q = std::clamp<int64_t>(q, -8, 7);
+
+        nibbles[i] = static_cast<int8_t>(q);
+        residuals[i] = static_cast<int32_t>(q) << scale;
+        out[i] = clamp16((residuals[i] * 2048ll + base) >> 11);
+
+        int32_t diff = out[i] - in[i];
+        error += static_cast<int64_t>(diff) * diff;
+    }
+
+    history[0] = out[HALF_FRAME - 2];
+    history[1] = out[HALF_FRAME - 1];
+
+    return error;
+}
+
+// Largest residual the predictor leaves when the residuals aren't quantized at all, a guess at the
+// scale the frame needs
+static int32_t peakResidual(const Predictor& t, const int16_t* in, const int16_t* history) {
+    int32_t peak = 0;
+    int16_t h[2] = { history[0], history[1] };
+
+    for (size_t half = 0; half < 2; half++) {
+        const int16_t* x = in + half * HALF_FRAME;
+        int32_t residuals[HALF_FRAME];
+
+        for (size_t i = 0; i < HALF_FRAME; i++) {
+            residuals[i] = static_cast<int32_t>(std::clamp<int64_t>(x[i] - predict(t, residuals, h, i) / 2048,
+                                                                    -65536, 65536));
+            peak = std::max(peak, std::abs(residuals[i]));
+        }
+
+        h[0] = x[HALF_FRAME - 2];
+        h[1] = x[HALF_FRAME - 1];
+    }
+
+    return peak;
+}
+
+void encodeVadpcmFrame(const VadpcmBook& book, const int16_t* in, int16_t* history, uint8_t* out,
+                       int16_t* decoded) {
+    int64_t bestError = std::numeric_limits<int64_t>::max();
+    int8_t bestNibbles[VADPCM_FRAME_SAMPLES] = {};
+    int16_t bestOut[VADPCM_FRAME_SAMPLES] = {};
+    int16_t bestHistory[2] = {};
+    int bestPredictor = 0, bestScale = 0;
+
+    for (size_t p = 0; p < VadpcmBook::PREDICTORS && bestError > 0; p++) {
+        const Predictor& t = book.table[p];
+
+        int32_t peak = peakResidual(t, in, history);
+        int scale = 0;
+        while (scale < MAX_SCALE && (peak >> scale) > 7) {
+            scale++;
+        }
+
+        for (int s = std::max(scale - 1, 0); s <= std::min(scale + 1, MAX_SCALE) && bestError > 0; s++) {
+            int8_t nibbles[VADPCM_FRAME_SAMPLES];
+            int16_t samples[VADPCM_FRAME_SAMPLES];
+            int16_t h[2] = { history[0], history[1] };
+
+            int64_t error = quantizeHalf(t, in, h, s, nibbles, samples);
+            if (error >= bestError) {
+                continue;
+            }
+            error += quantizeHalf(t, in + HALF_FRAME, h, s, nibbles + HALF_FRAME, samples + HALF_FRAME);
+
+            if (error < bestError) {
+                bestError = error;
+                bestPredictor = p;
+                bestScale = s;
+                std::memcpy(bestNibbles, nibbles, sizeof(nibbles));
+                std::memcpy(bestOut, samples, sizeof(samples));
+                bestHistory[0] = h[0];
+                bestHistory[1] = h[1];
+            }
+        }
+    }
+
+    out[0] = static_cast<uint8_t>((bestScale << 4) | bestPredictor);
+    for (size_t i = 0; i < VADPCM_FRAME_SAMPLES / 2; i++) {
+        out[1 + i] = static_cast<uint8_t>(((bestNibbles[i * 2] & 0xF) << 4) | (bestNibbles[i * 2 + 1] & 0xF));
+    }
+
+    history[0] = bestHistory[0];
+    history[1] = bestHistory[1];
+
+    if (decoded) {
+        std::memcpy(decoded, bestOut, sizeof(bestOut));
+    }
+}
+
+void decodeVadpcmFrame(const VadpcmBook& book, const uint8_t* in, int16_t* history, int16_t* out) {
+    int scale = std::min(in[0] >> 4, MAX_SCALE);
+    const Predictor& t = book.table[(in[0] & 0xF) % VadpcmBook::PREDICTORS];
+
+    for (size_t half = 0; half < 2; half++) {
+        int32_t residuals[HALF_FRAME];
+        int16_t* y = out + half * HALF_FRAME;
+
+        for (size_t i = 0; i < HALF_FRAME; i++) {
+            uint8_t byte = in[1 + half * 4 + i / 2];
+            int32_t nibble = (i & 1) ? (byte & 0xF) : (byte >> 4);
+            residuals[i] = (nibble >= 8 ? nibble - 16 : nibble) << scale;
+            y[i] = clamp16((residuals[i] * 2048ll + predict(t, residuals, history, i)) >> 11);
+        }
+
+        history[0] = y[HALF_FRAME - 2];
+        history[1] = y[HALF_FRAME - 1];
+    }
+}
+
+void encodeVadpcmPlane(uint8_t* plane, const VadpcmBook& book, const int16_t* src, size_t frames,
+                       size_t trackCount, size_t trackNo, const int16_t* history) {
+    int16_t h[2] = { history[0], history[1] };
+    size_t pos = 0;
+
+    for (size_t start = 0; start < frames; start += VADPCM_FRAME_SAMPLES) {
+        int16_t in[VADPCM_FRAME_SAMPLES] = {};
+        uint8_t out[VADPCM_FRAME_BYTES];
+        size_t n = std::min(VADPCM_FRAME_SAMPLES, frames - start);
+
+        for (size_t i = 0; i < n; i++) {
+            in[i] = src[(start + i) * trackCount + trackNo];
+        }
+
+        encodeVadpcmFrame(book, in, h, out);
+
+        for (size_t i = 0; i < VADPCM_FRAME_BYTES; i++, pos++) {
+            plane[pos ^ 3] = out[i];
+        }
+    }
+}
+
+// Expands x[n] = c1 * x[n - 1] + c2 * x[n - 2] into how each of the two previous samples carries
+// through the next 8, which is what the RSP multiplies by
+static void expandPredictor(double c1, double c2, Predictor& t) {
+    for (size_t k = 0; k < VadpcmBook::ORDER; k++) {
+        double prev2 = k == 0 ? 1.0 : 0.0;
+        double prev1 = k == 0 ? 0.0 : 1.0;
+
+        for (size_t i = 0; i < HALF_FRAME; i++) {
+            double y = c1 * prev1 + c2 * prev2;
+            t[k][i] = clamp16(std::llround(y * 2048.0));
+            prev2 = prev1;
+            prev1 = y;
+        }
+    }
+}
+
+static void clampStable(double& c1, double& c2) {
+    c2 = std::clamp(c2, -STABILITY_MARGIN, STABILITY_MARGIN);
+    double limit = STABILITY_MARGIN * (1.0 - c2);
+    c1 = std::clamp(c1, -limit, limit);
+}
+
+// Each frame's sums are scaled by its energy, so quiet passages shape the book as much as loud ones
+void VadpcmDesigner::add(const int16_t* samples, size_t count, size_t stride) {
+    for (size_t start = 2; start + VADPCM_FRAME_SAMPLES <= count; start += VADPCM_FRAME_SAMPLES) {
+        FrameStats s = {};
+
+        for (size_t n = start; n < start + VADPCM_FRAME_SAMPLES; n++) {
+            double x = samples[n * stride];
+            double a = samples[(n - 1) * stride];
+            double b = samples[(n - 2) * stride];
+
+            s.r11 += a * a;
+            s.r12 += a * b;
+            s.r22 += b * b;
+            s.x1 += x * a;
+            s.x2 += x * b;
+            s.xx += x * x;
+        }
+
+        if (s.xx == 0.0) {
+            continue;
+        }
+
+        double w = 1.0 / s.xx;
+        frames.push_back({ s.r11 * w, s.r12 * w, s.r22 * w, s.x1 * w, s.x2 * w, 1.0 });
+    }
+}
+
+VadpcmBook VadpcmDesigner::design() const {
+    // Silence, then a held value, a straight line, and a gentle curve to start from
+    double c1[VadpcmBook::PREDICTORS] = { 0.0, 1.0, 2.0, 1.5 };
+    double c2[VadpcmBook::PREDICTORS] = { 0.0, 0.0, -1.0, -0.6 };
+
+    for (size_t p = 1; p < VadpcmBook::PREDICTORS; p++) {
+        clampStable(c1[p], c2[p]);
+    }
+
+    auto error = [](const FrameStats& s, double a, double b) {
+        return s.xx - 2.0 * (a * s.x1 + b * s.x2) + a * a * s.r11 + 2.0 * a * b * s.r12 + b * b * s.r22;
+    };
+
+    for (int iteration = 0; iteration < DESIGN_ITERATIONS; iteration++) {
+        FrameStats sums[VadpcmBook::PREDICTORS] = {};
+        size_t counts[VadpcmBook::PREDICTORS] = {};
+
+        for (const auto& s : frames) {
+            size_t best = 0;
+            double bestError = error(s, c1[0], c2[0]);
+
+            for (size_t p = 1; p < VadpcmBook::PREDICTORS; p++) {
+                double e = error(s, c1[p], c2[p]);
+                if (e < bestError) {
+                    bestError = e;
+                    best = p;
+                }
+            }
+
+            sums[best].r11 += s.r11;
+            sums[best].r12 += s.r12;
+            sums[best].r22 += s.r22;
+            sums[best].x1 += s.x1;
+            sums[best].x2 += s.x2;
+            counts[best]++;
+        }
+
+        // Least squares fit of each predictor to its frames. Predictors nothing chose keep their place.
+        for (size_t p = 1; p < VadpcmBook::PREDICTORS; p++) {
+            const FrameStats& s = sums[p];
+            if (counts[p] == 0 || s.r11 <= 0.0) {
+                continue;
+            }
+
+            double det = s.r11 * s.r22 - s.r12 * s.r12;
+            if (det > 1e-9 * s.r11 * s.r22) {
+                c1[p] = (s.x1 * s.r22 - s.x2 * s.r12) / det;
+                c2[p] = (s.x2 * s.r11 - s.x1 * s.r12) / det;
+            } else {
+                c1[p] = s.x1 / s.r11;
+                c2[p] = 0.0;
+            }
+
+            clampStable(c1[p], c2[p]);
+        }
+    }
+
+    VadpcmBook book;
+    for (size_t p = 0; p < VadpcmBook::PREDICTORS; p++) {
+        expandPredictor(c1[p], c2[p], book.table[p]);
+    }
+
+    return book;
+}
+
+void copyBytesToRdram(uint8_t* rdram, int32_t ptr, const uint8_t* plane, size_t start, size_t count) {
+    size_t i = 0;
+
+    // Block copies are only possible when the plane and rdram agree on where a word starts
+    if (((static_cast<uint32_t>(ptr) - start) & 3) == 0) {
+        for (; i < count && ((start + i) & 3) != 0; i++) {
+            MEM_BU(ptr, i) = plane[(start + i) ^ 3];
+        }
+
+        size_t words = (count - i) / 4;
+        if (words > 0) {
+            std::memcpy(&MEM_W(ptr, i), plane + start + i, words * 4);
+            i += words * 4;
+        }
+    }
+
+    for (; i < count; i++) {
+        MEM_BU(ptr, i) = plane[(start + i) ^ 3];
+    }
+}
+
+} // namespace Dsp
@@ -4,6 +4,7 @@
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <plog/Log.h>
 #include <plog/Init.h>
@@ -12,12 +13,16 @@
 
 #include <audio_api/types.h>
 
+#include <extlib/cache/diskcache.hpp>
 #include <extlib/lib_recomp.hpp>
 #include <extlib/resource/abstract.hpp>
 #include <extlib/resource/audiofile.hpp>
 #include <extlib/resource/generic.hpp>
 #include <extlib/resource/samplebank.hpp>
+#include <extlib/stats.hpp>
 #include <extlib/thread.hpp>
+#include <extlib/trace.hpp>
+#include <extlib/vfs/zip_file.hpp>
 
 extern "C" {
     DLLEXPORT uint32_t recomp_api_version = RECOMP_API_VERSION;
@@ -26,11 +31,11 @@ extern "C" {
 namespace fs = std::filesystem;
 
 static bool sIsInitialized = false;
-static size_t sResourceCount = 0;
 
 Vfs::Filesystem gVfs;
-std::unordered_map<size_t, std::shared_ptr<Resource::Abstract>> gResourceData;
-std::shared_mutex gResourceDataMutex;
+Cache::Manager gCacheManager;
+Cache::ProbeIndex gProbeIndex;
+Resource::Registry gResources;
 
 static plog::ConsoleAppender<plog::TxtFormatter> sConsoleAppender;
 
@@ -55,12 +60,18 @@ RECOMP_DLL_FUNC(AudioApiNative_Init) {
             gVfs.addAllowedDir(rootDir / "mod_data");
             gVfs.addAllowedDir(rootDir / "mods");
 
+            Cache::DiskCache::setDirectory(rootDir / "mod_data" / "audio_cache");
+            Cache::DiskCache::prune();
+            gProbeIndex.load(rootDir / "mod_data" / "audio_cache" / "probe.idx");
+            Trace::setOutputPath(rootDir / "mod_data" / "audio_trace.json");
+
             gVfs.addKnownZipExtension(".zip");
             gVfs.addKnownZipExtension(".nrm");
             gVfs.addKnownZipExtension(".mmrs");
         }
 
         {
+            workerPoolStart();
             std::thread workerThread(workerThreadLoop);
             workerThread.detach();
         }
@@ -86,10 +97,76 @@ RECOMP_DLL_FUNC(AudioApiNative_Ready) {
 }
 
 RECOMP_DLL_FUNC(AudioApiNative_Tick) {
-    workerThreadNotify();
+    workerThreadTick();
+    RECOMP_RETURN(bool, true);
+}
+
+RECOMP_DLL_FUNC(AudioApiNative_SetOption) {
+    auto option = RECOMP_ARG(uint32_t, 0);
+    auto value = RECOMP_ARG(uint32_t, 1);
+
+    switch (option) {
+    case AUDIOAPI_OPTION_CACHE_BUDGET:
+        gCacheManager.setBudget(value);
+        break;
+    case AUDIOAPI_OPTION_WORKER_THREADS:
+        setWorkerCount(value);
+        break;
+    case AUDIOAPI_OPTION_SPLIT_DECODERS:
+        Resource::Audiofile::splitDecoders.store(value != 0);
+        break;
+    case AUDIOAPI_OPTION_DISK_CACHE:
+        Cache::DiskCache::enabled.store(value != 0);
+        break;
+    case AUDIOAPI_OPTION_RESAMPLE_RATE:
+        Resource::Audiofile::resampleRate.store(value);
+        break;
+    case AUDIOAPI_OPTION_COMPRESSED_CACHE:
+        Resource::Audiofile::compressCache.store(value != 0);
+        break;
+    case AUDIOAPI_OPTION_TRACE:
+        if (value != 0) {
+            Trace::start();
+        } else if (Trace::enabled.load() && !Trace::stop()) {
+            PLOG_ERROR << "Failed to write trace";
+        }
+        break;
+    case AUDIOAPI_OPTION_STREAM_FORMAT:
+        if (value > AUDIOAPI_STREAM_FORMAT_VADPCM) {
+            PLOG_ERROR << "Unknown stream format " << value;
+            RECOMP_RETURN(bool, false);
+        }
+        Resource::Audiofile::streamFormat.store(value);
+        break;
+    default:
+        PLOG_ERROR << "Unknown option " << option;
+        RECOMP_RETURN(bool, false);
+    }
+
     RECOMP_RETURN(bool, true);
 }
 
+RECOMP_DLL_FUNC(AudioApiNative_SetCacheQuota) {
+    auto baseDir = RECOMP_ARG_U8STR(0);
+    size_t bytes = RECOMP_ARG(uint32_t, 1);
+
+    try {
+        gCacheManager.setQuota(gVfs.resolveBaseDir(baseDir), bytes);
+        RECOMP_RETURN(bool, true);
+
+    } catch (const fs::filesystem_error& e) {
+        PLOG_ERROR << "Error setting cache quota: " << e.what();
+    } catch (const std::invalid_argument& e) {
+        PLOG_ERROR << "Error setting cache quota: " << e.what();
+    } catch (const std::runtime_error& e) {
+        PLOG_ERROR << "Error setting cache quota: " << e.what();
+    } catch (...) {
+        PLOG_ERROR << "Error setting cache quota: Unknown error";
+    }
+
+    RECOMP_RETURN(bool, false);
+}
+
 RECOMP_DLL_FUNC(AudioApiNative_Dma) {
     auto ptr = RECOMP_ARG(int32_t, 0);
     size_t size = RECOMP_ARG(uint32_t, 1);
@@ -99,18 +176,14 @@ RECOMP_DLL_FUNC(AudioApiNative_Dma) {
     size_t resourceId = args[0];
 
     try {
-        std::shared_ptr<Resource::Abstract> resource;
-        {
-            std::shared_lock<std::shared_mutex> lock(gResourceDataMutex);
-
-            auto it = gResourceData.find(resourceId);
-            if (it == gResourceData.end()) {
-                throw std::invalid_argument("Invalid resourceId " + std::to_string(resourceId));
-            }
-
-            resource = std::static_pointer_cast<Resource::Abstract>(it->second);
+        auto resource = gResources.find(resourceId);
+        if (resource == nullptr) {
+            throw std::invalid_argument("Invalid resourceId " + std::to_string(resourceId));
         }
 
+        Trace::Span span("dma", resourceId);
+
+        resource->touch();
         resource->dma(rdram, ptr, offset, size, args[1], args[2]);
         queuePreload(resourceId);
 
@@ -129,6 +202,78 @@ RECOMP_DLL_FUNC(AudioApiNative_Dma) {
     RECOMP_RETURN(bool, false);
 }
 
+RECOMP_DLL_FUNC(AudioApiNative_GetUnderrunCount) {
+    auto resourceId = RECOMP_ARG(int32_t, 0);
+    uint32_t count = 0;
+
+    if (resourceId < 0) {
+        gResources.forEach([&](size_t id, const Resource::ResourcePtr& resource) {
+            count += resource->underruns.load();
+        });
+    } else if (auto resource = gResources.find(resourceId)) {
+        count = resource->underruns.load();
+    }
+
+    RECOMP_RETURN(uint32_t, count);
+}
+
+// Pass a negative resourceId for the totals across all resources. Returns false, leaving stats
+// untouched, when the resource doesn't exist.
+RECOMP_DLL_FUNC(AudioApiNative_GetStats) {
+    auto resourceId = RECOMP_ARG(int32_t, 0);
+    auto stats = RECOMP_ARG(AudioApiStats*, 1);
+
+    if (resourceId >= 0 && !gResources.find(resourceId)) {
+        RECOMP_RETURN(bool, false);
+    }
+
+    Stats::toAudioApiStats(Stats::collect(resourceId), stats);
+
+    RECOMP_RETURN(bool, true);
+}
+
+// Fills in the codebook and the loop state of one track of a file streamed as VADPCM, for the
+// sample the game plays it through. The book needs room for every predictor.
+RECOMP_DLL_FUNC(AudioApiNative_GetVadpcmState) {
+    auto resourceId = RECOMP_ARG(uint32_t, 0);
+    auto trackNo = RECOMP_ARG(uint32_t, 1);
+    auto bookPtr = RECOMP_ARG(int32_t, 2);
+    auto loopPtr = RECOMP_ARG(int32_t, 3);
+
+    auto resource = dynamic_cast<Resource::Audiofile*>(gResources.find(resourceId));
+
+    if (!resource || !resource->isVadpcm() || trackNo >= resource->metadata->trackCount) {
+        RECOMP_RETURN(bool, false);
+    }
+
+    // Normally done by the first preload already, otherwise this waits for it
+    try {
+        resource->prepareVadpcm();
+    } catch (const std::runtime_error& e) {
+        PLOG_ERROR << "Could not fit a VADPCM codebook: " << e.what();
+        RECOMP_RETURN(bool, false);
+    }
+
+    const auto& book = resource->vadpcmBook();
+    const int16_t* codeBook = &book.table[0][0][0];
+    size_t entries = sizeof(book.table) / sizeof(int16_t);
+
+    // AdpcmBookHeader, then the expanded predictors
+    MEM_W(0, bookPtr) = Dsp::VadpcmBook::ORDER;
+    MEM_W(4, bookPtr) = Dsp::VadpcmBook::PREDICTORS;
+    for (size_t i = 0; i < entries; i++) {
+        MEM_H(8 + i * 2, bookPtr) = codeBook[i];
+    }
+
+    // AdpcmLoopHeader, then the predictor state
+    const int16_t* loopState = resource->vadpcmLoopState(trackNo);
+    for (size_t i = 0; i < Dsp::VADPCM_FRAME_SAMPLES; i++) {
+        MEM_H(16 + i * 2, loopPtr) = loopState[i];
+    }
+
+    RECOMP_RETURN(bool, true);
+}
+
 RECOMP_DLL_FUNC(AudioApiNative_AddResource) {
     auto info = RECOMP_ARG(AudioApiResourceInfo*, 0);
     auto baseDir = RECOMP_ARG_U8STR(1);
@@ -140,15 +285,12 @@ RECOMP_DLL_FUNC(AudioApiNative_AddResource) {
         auto file = gVfs.openFile(baseDir, path);
         auto resource = std::make_shared<Resource::Generic>(file, cacheStrategy);
 
-        info->resourceId = sResourceCount++;
         info->cacheStrategy = static_cast<AudioApiCacheStrategy>(cacheStrategy);
         info->filesize = resource->size();
         file->close();
 
-        {
-            std::unique_lock<std::shared_mutex> lock(gResourceDataMutex);
-            gResourceData[info->resourceId] = std::move(resource);
-        }
+        info->resourceId = gResources.add(std::move(resource));
+        gCacheManager.setOwner(info->resourceId, gVfs.resolveBaseDir(baseDir));
 
         queuePreload(info->resourceId);
 
@@ -167,49 +309,78 @@ RECOMP_DLL_FUNC(AudioApiNative_AddResource) {
     RECOMP_RETURN(bool, false);
 }
 
-RECOMP_DLL_FUNC(AudioApiNative_AddAudioFile) {
-    auto info = RECOMP_ARG(AudioApiFileInfo*, 0);
-    auto baseDir = RECOMP_ARG_U8STR(1);
-    auto path = RECOMP_ARG_U8STR(2);
+// Fills in the metadata from what the mod supplied, from the probe index, or by probing the file.
+// Does not touch shared registration state, so batches run it on several threads at once.
+static std::shared_ptr<Resource::Audiofile> probeAudioFile(AudioApiFileInfo* info, std::shared_ptr<Vfs::File> file,
+                                                           const std::string& probeKey) {
     auto codec = Decoder::parseType(info->codec);
     auto cacheStrategy = Resource::parseCacheStrategy(info->cacheStrategy);
+    auto resampleRate = Resource::Audiofile::resampleRate.load();
+    std::shared_ptr<Resource::Audiofile> resource;
+    Cache::ProbeEntry probe;
+
+    if (info->trackCount && info->sampleCount) {
+        resource = std::make_shared<Resource::Audiofile>(file, codec, cacheStrategy);
+        resource->metadata->setTrackCount(info->trackCount);
+        resource->metadata->setSampleRate(info->sampleRate);
+        resource->metadata->setSampleCount(info->sampleCount);
+        resource->metadata->setLoopInfo(info->loopStart, info->loopEnd, info->loopCount);
+        file->close();
+    } else if (gProbeIndex.find(probeKey, *file, probe) && probe.resampleRate == resampleRate &&
+               (codec == Decoder::Type::Auto || static_cast<Decoder::Type>(probe.codec) == codec)) {
+        resource = std::make_shared<Resource::Audiofile>(file, probe, cacheStrategy);
+        file->close();
+    } else {
+        resource = std::make_shared<Resource::Audiofile>(file, codec, cacheStrategy, resampleRate);
+        resource->open();
+        resource->probe();
+        resource->close();
+        gProbeIndex.store(probeKey, *file, resource->probeEntry());
+    }
 
-    try {
-        auto file = gVfs.openFile(baseDir, path);
-        auto resource = std::make_shared<Resource::Audiofile>(file, codec, cacheStrategy);
-
-        if (info->trackCount && info->sampleCount) {
-            resource->metadata->setTrackCount(info->trackCount);
-            resource->metadata->setSampleRate(info->sampleRate);
-            resource->metadata->setSampleCount(info->sampleCount);
-            resource->metadata->setLoopInfo(info->loopStart, info->loopEnd, info->loopCount);
-            file->close();
-        } else {
-            resource->open();
-            resource->probe();
-            resource->close();
+    // The codebook isn't part of the probe index, so it is fit again every session on the first preload
+    if (Resource::Audiofile::streamFormat.load() == AUDIOAPI_STREAM_FORMAT_VADPCM) {
+        try {
+            resource->enableVadpcm();
+        } catch (const std::runtime_error& e) {
+            PLOG_WARNING << "Streaming " << file->fullpath() << " as PCM: " << e.what();
         }
+    }
 
-        info->resourceId  = sResourceCount++;
-        info->trackCount  = resource->metadata->trackCount;
-        info->sampleRate  = resource->metadata->sampleRate;
-        info->sampleCount = resource->metadata->sampleCount;
-        info->loopStart   = resource->metadata->loopStart;
-        info->loopEnd     = resource->metadata->loopEnd;
-        info->loopCount   = resource->metadata->loopCount;
-        info->cacheStrategy = static_cast<AudioApiCacheStrategy>(cacheStrategy);
+    info->trackCount  = resource->metadata->trackCount;
+    info->sampleRate  = resource->metadata->sampleRate;
+    info->sampleCount = resource->metadata->sampleCount;
+    info->loopStart   = resource->metadata->loopStart;
+    info->loopEnd     = resource->metadata->loopEnd;
+    info->loopCount   = resource->metadata->loopCount;
+    info->cacheStrategy = static_cast<AudioApiCacheStrategy>(cacheStrategy);
 
-        PLOG_DEBUG << "Added: " << file->fullpath();
-        PLOG_DEBUG << "sampleRate: " << info->sampleRate << " sampleCount: " << info->sampleCount
-                   << " trackCount: " << info->trackCount << " loopCount: " << info->loopCount
-                   << " loopStart: " << info->loopStart << " loopEnd: " << info->loopEnd;
+    PLOG_DEBUG << "Added: " << file->fullpath();
+    PLOG_DEBUG << "sampleRate: " << info->sampleRate << " sampleCount: " << info->sampleCount
+               << " trackCount: " << info->trackCount << " loopCount: " << info->loopCount
+               << " loopStart: " << info->loopStart << " loopEnd: " << info->loopEnd;
 
-        {
-            std::unique_lock<std::shared_mutex> lock(gResourceDataMutex);
-            gResourceData[info->resourceId] = std::move(resource);
-        }
+    return resource;
+}
 
-        queuePreload(info->resourceId);
+static void registerAudioFile(AudioApiFileInfo* info, std::shared_ptr<Resource::Audiofile> resource, fs::path owner) {
+    info->resourceId = gResources.add(std::move(resource));
+    gCacheManager.setOwner(info->resourceId, owner);
+
+    queuePreload(info->resourceId);
+}
+
+RECOMP_DLL_FUNC(AudioApiNative_AddAudioFile) {
+    auto info = RECOMP_ARG(AudioApiFileInfo*, 0);
+    auto baseDir = RECOMP_ARG_U8STR(1);
+    auto path = RECOMP_ARG_U8STR(2);
+
+    try {
+        auto file = gVfs.openFile(baseDir, path);
+        auto owner = gVfs.resolveBaseDir(baseDir);
+        auto resource = probeAudioFile(info, file, (owner / fs::path(path)).string());
+
+        registerAudioFile(info, std::move(resource), owner);
 
         RECOMP_RETURN(bool, true);
 
@@ -219,7 +390,6 @@ RECOMP_DLL_FUNC(AudioApiNative_AddAudioFile) {
         PLOG_ERROR << "Error probing file: " << e.what();
     } catch (const std::runtime_error& e) {
         PLOG_ERROR << "Error probing file: " << e.what();
-        //PLOG_ERROR << "Error probing file: " << baseDir << "/" << path << " Reason: " << e.what();
     } catch (...) {
         PLOG_ERROR << "Error probing file: Unknown error";
     }
@@ -227,6 +397,94 @@ RECOMP_DLL_FUNC(AudioApiNative_AddAudioFile) {
     RECOMP_RETURN(bool, false);
 }
 
+// More than any mod ships in one directory, and small enough that a garbage count is turned away
+constexpr uint32_t MAX_BATCH_FILES = 65536;
+
+// Registers many files from one directory at once. Files are probed in parallel, then registered in
+// order, so resource ids come out the same as adding them one by one. Returns how many were added.
+RECOMP_DLL_FUNC(AudioApiNative_AddAudioFiles) {
+    auto infos = RECOMP_ARG(AudioApiFileInfo*, 0);
+    auto baseDir = RECOMP_ARG_U8STR(1);
+    auto filenames = RECOMP_ARG(PTR(char)*, 2);
+    auto count = RECOMP_ARG(uint32_t, 3);
+
+    if (count > MAX_BATCH_FILES) {
+        PLOG_ERROR << "Error adding files: " << count << " files in one batch is more than " << MAX_BATCH_FILES;
+        RECOMP_RETURN(uint32_t, 0);
+    }
+
+    std::vector<std::shared_ptr<Vfs::File>> files(count);
+    std::vector<std::string> probeKeys(count);
+    std::vector<std::shared_ptr<Resource::Audiofile>> resources(count);
+    fs::path owner;
+
+    try {
+        owner = gVfs.resolveBaseDir(baseDir);
+    } catch (const std::exception& e) {
+        PLOG_ERROR << "Error adding files: " << e.what();
+        RECOMP_RETURN(uint32_t, 0);
+    } catch (...) {
+        PLOG_ERROR << "Error adding files: Unknown error";
+        RECOMP_RETURN(uint32_t, 0);
+    }
+
+    // Opening a file only looks it up, and the filesystem is not safe to share between threads
+    for (uint32_t i = 0; i < count; i++) {
+        auto path = ptr_to_u8string(rdram, filenames[i]);
+        try {
+            files[i] = gVfs.openFile(baseDir, path);
+            probeKeys[i] = (owner / fs::path(path)).string();
+        } catch (const std::exception& e) {
+            PLOG_ERROR << "Error opening file: " << e.what();
+        } catch (...) {
+            PLOG_ERROR << "Error opening file: Unknown error";
+        }
+    }
+
+    // Entries of an archive all read through its one handle, so they are probed one after another
+    // on a single task, while loose files get a task each
+    std::vector<uint32_t> loose;
+    std::vector<uint32_t> archived;
+    for (uint32_t i = 0; i < count; i++) {
+        if (files[i]) {
+            (dynamic_cast<Vfs::ZipFile*>(files[i].get()) ? archived : loose).push_back(i);
+        }
+    }
+
+    auto probe = [&](uint32_t i) {
+        try {
+            resources[i] = probeAudioFile(&infos[i], files[i], probeKeys[i]);
+        } catch (const std::exception& e) {
+            PLOG_ERROR << "Error probing file: " << e.what();
+        } catch (...) {
+            PLOG_ERROR << "Error probing file: Unknown error";
+        }
+    };
+
+    parallelFor(loose.size() + 1, [&](size_t n) {
+        if (n < loose.size()) {
+            probe(loose[n]);
+            return;
+        }
+        for (uint32_t i : archived) {
+            probe(i);
+        }
+    });
+
+    uint32_t added = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (resources[i]) {
+            registerAudioFile(&infos[i], std::move(resources[i]), owner);
+            added++;
+        } else {
+            infos[i].resourceId = AUDIOAPI_INVALID_RESOURCE_ID;
+        }
+    }
+
+    RECOMP_RETURN(uint32_t, added);
+}
+
 RECOMP_DLL_FUNC(AudioApiNative_AddSampleBank) {
     auto info = RECOMP_ARG(AudioApiSampleBankInfo*, 0);
     auto baseDir = RECOMP_ARG_U8STR(1);
@@ -238,15 +496,12 @@ RECOMP_DLL_FUNC(AudioApiNative_AddSampleBank) {
         auto file = gVfs.openFile(baseDir, path);
         auto resource = std::make_shared<Resource::SampleBank>(file, cacheStrategy);
 
-        info->resourceId = sResourceCount++;
         info->cacheStrategy = static_cast<AudioApiCacheStrategy>(cacheStrategy);
         info->filesize = resource->size();
         file->close();
 
-        {
-            std::unique_lock<std::shared_mutex> lock(gResourceDataMutex);
-            gResourceData[info->resourceId] = std::move(resource);
-        }
+        info->resourceId = gResources.add(std::move(resource));
+        gCacheManager.setOwner(info->resourceId, gVfs.resolveBaseDir(baseDir));
 
         queuePreload(info->resourceId);
 
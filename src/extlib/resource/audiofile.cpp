@@ -1,164 +1,960 @@
 #include <extlib/resource/audiofile.hpp>
 
 #include <algorithm>
+#include <cstring>
+#include <tuple>
 
-#include <mod_recomp.h>
+#include <extlib/cache/manager.hpp>
+#include <extlib/decoder/resampled.hpp>
+#include <extlib/dsp/pcm.hpp>
+#include <extlib/stats.hpp>
 #include <extlib/thread.hpp>
+#include <extlib/trace.hpp>
 
+#include <mod_recomp.h>
 #include <plog/Log.h>
 
 namespace Resource {
 
 constexpr int FILE_TTL_SECONDS = 30;
-constexpr size_t CHUNK_SIZE = 1024;
 constexpr int CACHE_INITIAL_CHUNKS = 8;
 constexpr int CACHE_FOLLOWUP_CHUNKS = 32;
+constexpr auto IDLE_PRELOAD_DELAY = std::chrono::milliseconds(500);
+// Audio frames without a dma after which a file counts as paused
+constexpr int PAUSED_AFTER_TICKS = 4;
+
+// Audio the VADPCM codebook is fit to, from the start of the file
+constexpr size_t VADPCM_ANALYSIS_FRAMES = 1 << 17;
 
-inline size_t CHUNK_START(size_t offset) {
-    return (offset / CHUNK_SIZE) * CHUNK_SIZE;
+// Encoded chunks hold whole frames and take up whole words
+constexpr size_t VADPCM_CHUNK_ALIGN = 64;
+
+std::atomic<bool> Audiofile::splitDecoders = true;
+std::atomic<uint32_t> Audiofile::streamFormat = AUDIOAPI_STREAM_FORMAT_PCM;
+std::atomic<uint32_t> Audiofile::resampleRate = 0;
+std::atomic<bool> Audiofile::compressCache = true;
+
+static CacheStrategy resolveCacheStrategy(CacheStrategy cacheStrategy) {
+    return cacheStrategy == CacheStrategy::Default ? CacheStrategy::PreloadOnUse : cacheStrategy;
 }
 
-inline size_t CHUNK_END(size_t offset) {
-    return CHUNK_START(offset) + CHUNK_SIZE;
+// With a resample rate, the decoder's output is converted to that rate and the metadata describes
+// the converted stream
+Audiofile::Audiofile(std::shared_ptr<Vfs::File> file, Decoder::Type type, CacheStrategy cacheStrategy,
+                     uint32_t resampleRate)
+    : file(file), codec(type), outputRate(resampleRate), cacheStrategy(resolveCacheStrategy(cacheStrategy)) {
+
+    getDecoder();
 }
 
-Audiofile::Audiofile(std::shared_ptr<Vfs::File> file, Decoder::Type type, CacheStrategy cacheStrategy)
-    : file(file), cacheStrategy(cacheStrategy) {
+// Registers a file from its saved probe results, without creating a decoder yet
+Audiofile::Audiofile(std::shared_ptr<Vfs::File> file, const Cache::ProbeEntry& probe, CacheStrategy cacheStrategy)
+    : file(file), codec(static_cast<Decoder::Type>(probe.codec)), outputRate(probe.resampleRate),
+      cacheStrategy(resolveCacheStrategy(cacheStrategy)) {
 
-    decoder = Decoder::factory(file, type);
-    metadata = decoder->metadata;
+    metadata = std::make_shared<Decoder::Metadata>();
+    metadata->trackCount = probe.trackCount;
+    metadata->sampleRate = probe.sampleRate;
+    metadata->sampleCount = probe.sampleCount;
+    metadata->loopStart = probe.loopStart;
+    metadata->loopEnd = probe.loopEnd;
+    metadata->loopCount = probe.loopCount;
 
-    if (cacheStrategy == CacheStrategy::Default) {
-        cacheStrategy = CacheStrategy::PreloadOnUse;
-    }
+    setChunkSize(probe.chunkFrames);
 }
 
 Audiofile::~Audiofile() {
     close();
 }
 
+// Creating a decoder can mean reading the file to tell Ogg codecs apart, so files restored from the
+// probe index put it off until they are first played
+Decoder::Abstract* Audiofile::getDecoder() {
+    std::call_once(decoderOnce, [this] {
+        auto decoder = Decoder::factory(file, codec.load());
+
+        if (outputRate != 0) {
+            decoder = std::make_unique<Decoder::Resampled>(file, std::move(decoder), outputRate);
+        }
+
+        if (metadata) {
+            decoder->restore(metadata, chunkSize);
+        } else {
+            metadata = decoder->metadata;
+            setChunkSize(decoder->chunkSize());
+        }
+
+        codec.store(decoder->type());
+        this->decoder = std::move(decoder);
+        hasDecoder.store(true, std::memory_order_release);
+    });
+
+    return decoder.get();
+}
+
 void Audiofile::open() {
+    Trace::Span span("open");
+
     file->open();
-    decoder->open();
+    getDecoder()->open();
     atime.store(std::chrono::steady_clock::now());
 }
 
 void Audiofile::close() {
-    decoder->close();
+    if (hasDecoder.load(std::memory_order_acquire)) {
+        decoder->close();
+    }
     file->close();
+
+    {
+        std::lock_guard<std::mutex> preloadLock(preloadDecoderMutex);
+        if (preloadDecoder) {
+            preloadDecoder->close();
+            preloadFile->close();
+        }
+    }
+
     pos.store(0);
     atime.store(EPOCH);
 }
 
 void Audiofile::probe() {
+    auto decoder = getDecoder();
     decoder->probe();
-    numChunks = (metadata->sampleCount / CHUNK_SIZE) - (metadata->loopStart / CHUNK_SIZE) + 1;
+    setChunkSize(decoder->chunkSize());
+    buildSeekIndex(decoder);
+}
+
+Cache::ProbeEntry Audiofile::probeEntry() const {
+    return {
+        .size = 0,
+        .fingerprint = 0,
+        .codec = static_cast<uint32_t>(codec.load()),
+        .resampleRate = outputRate,
+        .chunkFrames = static_cast<uint32_t>(chunkSize),
+        .trackCount = metadata->trackCount,
+        .sampleRate = metadata->sampleRate,
+        .sampleCount = metadata->sampleCount,
+        .loopStart = metadata->loopStart,
+        .loopEnd = metadata->loopEnd,
+        .loopCount = metadata->loopCount,
+    };
+}
+
+// Switches the file over to streaming VADPCM, before anything is cached. Only sets up the layout,
+// the codebook is fit later by prepareVadpcm.
+void Audiofile::enableVadpcm() {
+    if (metadata->sampleCount == 0 || metadata->trackCount == 0) {
+        throw std::runtime_error("VADPCM needs the length of the file");
+    }
+
+    if (chunkSize % VADPCM_CHUNK_ALIGN != 0) {
+        setChunkSize(Decoder::DEFAULT_CHUNK_SIZE);
+    }
+
+    uint32_t trackCount = metadata->trackCount;
+
+    encodedStride = Dsp::vadpcmFrames(chunkSize) * Dsp::VADPCM_FRAME_BYTES;
+    chunkTails.assign((metadata->sampleCount / chunkSize + 1) * trackCount * 2, 0);
+    chunkTailKnown.assign(metadata->sampleCount / chunkSize + 1, false);
+    loopStates.assign(trackCount * Dsp::VADPCM_FRAME_SAMPLES, 0);
+
+    vadpcm = true;
+}
+
+// Fits the codebook to the start of the file and finds the loop state by encoding up to the loop
+// point. The first preload does this on a worker, and anything that needs either before then waits
+// for it, or does it itself. Throws if the file can't be decoded, and tries again on the next call.
+void Audiofile::prepareVadpcm() {
+    std::call_once(vadpcmOnce, [this] {
+        uint32_t trackCount = metadata->trackCount;
+        size_t analysisFrames = std::min<size_t>(metadata->sampleCount, VADPCM_ANALYSIS_FRAMES);
+        size_t framesRead;
+        Dsp::VadpcmDesigner designer;
+
+        for (size_t offset = 0; offset + 1 < analysisFrames; offset += chunkSize) {
+            const auto& interleaved = decodeChunk(offset, true, framesRead);
+            for (uint32_t trackNo = 0; trackNo < trackCount; trackNo++) {
+                designer.add(interleaved.data() + trackNo, framesRead, trackCount);
+            }
+        }
+
+        book = designer.design();
+
+        // The RSP restarts a loop from the frame holding the loop start, decoded as it was the first time
+        size_t loopFrame = metadata->loopStart / Dsp::VADPCM_FRAME_SAMPLES * Dsp::VADPCM_FRAME_SAMPLES;
+        size_t loopChunk = chunkStart(loopFrame);
+
+        if (loopChunk + 1 < metadata->sampleCount) {
+            auto history = chunkHistory(loopChunk / chunkSize, true);
+            const auto& interleaved = decodeChunk(loopChunk, true, framesRead);
+
+            for (uint32_t trackNo = 0; trackNo < trackCount; trackNo++) {
+                int16_t* h = history.data() + trackNo * 2;
+                int16_t* loopState = loopStates.data() + trackNo * Dsp::VADPCM_FRAME_SAMPLES;
+
+                for (size_t start = loopChunk; start <= loopFrame; start += Dsp::VADPCM_FRAME_SAMPLES) {
+                    int16_t in[Dsp::VADPCM_FRAME_SAMPLES] = {};
+                    uint8_t out[Dsp::VADPCM_FRAME_BYTES];
+
+                    for (size_t i = 0; i < Dsp::VADPCM_FRAME_SAMPLES && start - loopChunk + i < framesRead; i++) {
+                        in[i] = interleaved[(start - loopChunk + i) * trackCount + trackNo];
+                    }
+
+                    Dsp::encodeVadpcmFrame(book, in, h, out, loopState);
+                }
+            }
+        }
+    });
 }
 
-std::shared_ptr<std::vector<int16_t>> Audiofile::getChunk(size_t offset) {
+// Without an index seeks still work, they just fall back to the codec's own search
+void Audiofile::buildSeekIndex(Decoder::Abstract* decoder) {
     try {
-        std::shared_lock<std::shared_mutex> cacheLock(cacheMutex);
-        return cache.at(offset);
-    } catch (const std::out_of_range& e) {
-        if (gMainThreadId == std::this_thread::get_id()) {
-            PLOG_DEBUG << "Cache miss " << offset;
+        decoder->index();
+    } catch (const std::runtime_error& e) {
+        PLOG_WARNING << "Failed to index " << file->fullpath() << ": " << e.what();
+    }
+}
+
+// Looks up decoded audio from a previous session. A cache file only matches while the source has
+// the same size and fingerprint, so the source itself is never read to check it.
+void Audiofile::attachDiskCache() {
+    if (diskCache || vadpcm || !Cache::DiskCache::isEnabled() || metadata->sampleCount == 0) {
+        return;
+    }
+
+    try {
+        Cache::DiskCacheKey key = {
+            .sourceFingerprint = file->fingerprint(),
+            .sourceSize = file->size(),
+            .codec = static_cast<uint32_t>(codec.load()),
+            .trackCount = metadata->trackCount,
+            .sampleRate = metadata->sampleRate,
+            .sampleCount = metadata->sampleCount,
+            .chunkFrames = static_cast<uint32_t>(chunkSize),
+            .planeStride = static_cast<uint32_t>(planeStride),
+        };
+
+        auto cache = std::make_unique<Cache::DiskCache>(file->fullpath(), key);
+
+        std::unique_lock<std::shared_mutex> cacheLock(cacheMutex);
+        diskCache = std::move(cache);
+
+    } catch (const std::runtime_error& e) {
+        PLOG_WARNING << "Disk cache unavailable for " << file->fullpath() << ": " << e.what();
+    }
+}
+
+// Chunks cover a whole number of codec frames, so decoding one never has to throw away part of a
+// frame. The size is fixed before anything is cached.
+void Audiofile::setChunkSize(size_t frames) {
+    chunkSize = frames;
+    planeStride = Dsp::planeStride(frames);
+}
+
+size_t Audiofile::chunkStart(size_t offset) const {
+    return (offset / chunkSize) * chunkSize;
+}
+
+size_t Audiofile::chunkEnd(size_t offset) const {
+    return chunkStart(offset) + chunkSize;
+}
+
+// Start of the chunk played after the one at offset
+size_t Audiofile::nextChunk(size_t offset) const {
+    offset += chunkSize;
+    return offset >= metadata->sampleCount ? chunkStart(metadata->loopStart) : offset;
+}
+
+size_t Audiofile::numChunks() const {
+    return (metadata->sampleCount / chunkSize) - (metadata->loopStart / chunkSize) + 1;
+}
+
+// Distance in chunks from the playback position to the given chunk, following loops
+size_t Audiofile::chunkDistance(size_t curChunk, size_t thisChunk) const {
+    return (curChunk > thisChunk)
+        ? (numChunks() - (curChunk - thisChunk))
+        : (thisChunk - curChunk);
+}
+
+// Tracks worth keeping in memory. Until dma asks for anything, that is every track.
+uint64_t Audiofile::trackMask() const {
+    uint64_t mask = activeTracks.load() | requestedTracks.load();
+    return mask != 0 ? mask : ~0ull;
+}
+
+// Tracks past the width of the mask are always cached
+bool Audiofile::isTrackCached(uint64_t mask, uint32_t trackNo) const {
+    return trackNo >= 64 || (mask & (1ull << trackNo)) != 0;
+}
+
+// The memory cache holds one plane per slot, keyed by chunk and track
+uint32_t Audiofile::planeKey(uint32_t chunkNo, uint32_t trackNo) const {
+    return chunkNo * metadata->trackCount + trackNo;
+}
+
+// Caller must hold cacheMutex
+const int16_t* Audiofile::findPlane(size_t offset, uint32_t trackNo) {
+    uint32_t chunkNo = offset / chunkSize;
+    uint32_t slot = table.find(planeKey(chunkNo, trackNo));
+
+    if (slot != Cache::ChunkTable::NOT_FOUND) {
+        return pool.data(slot);
+    }
+    if (diskCache && diskCache->has(chunkNo)) {
+        return diskCache->data(chunkNo) + trackNo * planeStride;
+    }
+    return nullptr;
+}
+
+bool Audiofile::hasChunk(size_t offset) {
+    std::shared_lock<std::shared_mutex> cacheLock(cacheMutex);
+    uint64_t mask = trackMask();
+
+    for (uint32_t trackNo = 0; trackNo < metadata->trackCount; trackNo++) {
+        if (isTrackCached(mask, trackNo) && findPlane(offset, trackNo) == nullptr) {
+            return false;
         }
     }
 
-    open();
+    return true;
+}
 
-    size_t framesToRead = std::min(CHUNK_SIZE, metadata->sampleCount - offset - 1);
-    auto buffer = std::make_shared<std::vector<int16_t>>(framesToRead * metadata->trackCount);
+// Preloading reads through its own decoder when enabled, so it never moves the read position of
+// the decoder that serves cache misses, and neither waits on the other's lock. Callers preloading
+// must hold preloadDecoderMutex for as long as they use the decoder.
+Decoder::Abstract* Audiofile::openDecoder(bool preload) {
+    if (!preload || !splitDecoders.load()) {
+        open();
+        return decoder.get();
+    }
 
-    size_t framesRead = decoder->decode(buffer.get(), framesToRead, offset);
+    if (!preloadDecoder) {
+        preloadFile = file->clone();
+        preloadDecoder = getDecoder()->clone(preloadFile);
+    }
+
+    preloadFile->open();
+    preloadDecoder->open();
+    atime.store(std::chrono::steady_clock::now());
+
+    return preloadDecoder.get();
+}
+
+// Returns the interleaved frames of the chunk at offset, valid until the thread decodes again
+const std::vector<int16_t>& Audiofile::decodeChunk(size_t offset, bool preload, size_t& framesRead) {
+    std::unique_lock<std::mutex> preloadLock(preloadDecoderMutex, std::defer_lock);
+    if (preload) {
+        preloadLock.lock();
+    }
+
+    auto decoder = openDecoder(preload);
+
+    thread_local std::vector<int16_t> interleaved;
+
+    size_t framesToRead = std::min(chunkSize, metadata->sampleCount - offset - 1);
+    interleaved.resize(framesToRead * metadata->trackCount);
+
+    Trace::Span span("decode", offset);
+
+    auto start = std::chrono::steady_clock::now();
+    framesRead = decoder->decode(&interleaved, framesToRead, offset);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    Stats::recordDecode(static_cast<uint32_t>(codec.load()), framesRead, elapsed);
+    if (!preload && gMainThreadId == std::this_thread::get_id()) {
+        Stats::add(stats.mainThreadDecodeNs, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
 
     if (framesRead != framesToRead) {
         throw std::runtime_error("Not enough samples read");
     }
 
+    return interleaved;
+}
+
+// Planes are stored already swizzled for rdram, padded with silence to the plane stride
+static void fillPlane(int16_t* plane, const std::vector<int16_t>& interleaved, size_t framesRead,
+                      size_t planeStride, uint32_t trackCount, uint32_t trackNo) {
+    Dsp::deinterleave(plane, interleaved.data(), framesRead, trackCount, trackNo);
+    for (size_t i = framesRead; i < planeStride; i++) {
+        plane[i ^ 1] = 0;
+    }
+}
+
+// Only preloaded files use the compressed tier, and only while the disk cache doesn't already keep
+// their decoded audio off the heap. VADPCM is compact enough as it is. Caller must hold cacheMutex.
+bool Audiofile::usesColdTier() const {
+    return cacheStrategy == CacheStrategy::Preload && compressCache.load() && !diskCache && !vadpcm;
+}
+
+// Moves a chunk from the compressed tier back into memory as PCM, if every plane that is needed
+// can be found there. Caller must hold cacheMutex exclusively.
+bool Audiofile::promoteChunk(uint32_t chunkNo, uint64_t mask) {
+    if (cold.size() == 0) {
+        return false;
+    }
+
+    for (uint32_t planeNo = 0; planeNo < metadata->trackCount; planeNo++) {
+        uint32_t key = planeKey(chunkNo, planeNo);
+        if (isTrackCached(mask, planeNo) && table.find(key) == Cache::ChunkTable::NOT_FOUND && !cold.has(key)) {
+            return false;
+        }
+    }
+
+    if (pool.chunkBytes() == 0) {
+        pool.reset(planeStride);
+    }
+
+    for (uint32_t planeNo = 0; planeNo < metadata->trackCount; planeNo++) {
+        uint32_t key = planeKey(chunkNo, planeNo);
+        if (!isTrackCached(mask, planeNo) || table.find(key) != Cache::ChunkTable::NOT_FOUND) {
+            continue;
+        }
+
+        uint32_t slot = pool.alloc();
+        cold.load(key, pool.data(slot), planeStride);
+        table.insert(key, slot);
+    }
+
+    return true;
+}
+
+// Decodes a chunk straight into the compressed tier, leaving the PCM tier alone
+void Audiofile::compressChunk(size_t offset) {
+    uint32_t chunkNo = offset / chunkSize;
+    uint32_t trackCount = metadata->trackCount;
+
+    {
+        std::shared_lock<std::shared_mutex> cacheLock(cacheMutex);
+        bool compressed = true;
+        for (uint32_t planeNo = 0; planeNo < trackCount; planeNo++) {
+            compressed = compressed && cold.has(planeKey(chunkNo, planeNo));
+        }
+        if (compressed) {
+            return;
+        }
+    }
+
+    size_t framesRead;
+    const auto& interleaved = decodeChunk(offset, true, framesRead);
+
+    thread_local std::vector<int16_t> plane;
+    plane.resize(planeStride);
+
+    std::vector<std::vector<uint8_t>> planes(trackCount);
+    for (uint32_t planeNo = 0; planeNo < trackCount; planeNo++) {
+        fillPlane(plane.data(), interleaved, framesRead, planeStride, trackCount, planeNo);
+        Cache::compressPlane(planes[planeNo], plane.data(), planeStride);
+    }
+
+    std::unique_lock<std::shared_mutex> cacheLock(cacheMutex);
+    for (uint32_t planeNo = 0; planeNo < trackCount; planeNo++) {
+        cold.store(planeKey(chunkNo, planeNo), std::move(planes[planeNo]));
+    }
+}
+
+// Last two samples of each track before the given chunk, as the file decodes, or silence before the
+// first chunk. The previous chunk is decoded for them if it hasn't been yet.
+std::vector<int16_t> Audiofile::chunkHistory(uint32_t chunkNo, bool preload) {
+    uint32_t trackCount = metadata->trackCount;
+    std::vector<int16_t> history(trackCount * 2, 0);
+
+    if (chunkNo == 0) {
+        return history;
+    }
+
+    auto copyTail = [&] {
+        std::copy_n(chunkTails.begin() + (chunkNo - 1) * trackCount * 2, trackCount * 2, history.begin());
+    };
+
+    {
+        std::shared_lock<std::shared_mutex> cacheLock(cacheMutex);
+        if (chunkTailKnown[chunkNo - 1]) {
+            copyTail();
+            return history;
+        }
+    }
+
+    size_t framesRead;
+    const auto& interleaved = decodeChunk((chunkNo - 1) * chunkSize, preload, framesRead);
+
     std::unique_lock<std::shared_mutex> cacheLock(cacheMutex);
-    cache[offset] = buffer;
+    storeChunkTail(chunkNo - 1, interleaved, framesRead);
+    copyTail();
 
-    return buffer;
+    return history;
 }
 
+// Caller must hold cacheMutex exclusively
+void Audiofile::storeChunkTail(uint32_t chunkNo, const std::vector<int16_t>& interleaved, size_t framesRead) {
+    if (chunkNo >= chunkTailKnown.size() || chunkTailKnown[chunkNo]) {
+        return;
+    }
+
+    uint32_t trackCount = metadata->trackCount;
+    int16_t* tail = chunkTails.data() + chunkNo * trackCount * 2;
+
+    for (uint32_t planeNo = 0; planeNo < trackCount; planeNo++) {
+        for (size_t k = 0; k < 2; k++) {
+            tail[planeNo * 2 + k] = framesRead + k >= 2
+                ? interleaved[(framesRead + k - 2) * trackCount + planeNo]
+                : 0;
+        }
+    }
+
+    chunkTailKnown[chunkNo] = true;
+}
+
+// Encodes a chunk to VADPCM and keeps the planes of the tracks in use. The first frame of each track
+// is predicted from the decoded file rather than the encoded previous chunk, so a chunk comes out
+// the same whichever order chunks are loaded in, at the cost of a small error where they meet.
+void Audiofile::loadEncodedChunk(size_t offset, bool preload, uint32_t trackNo, uint64_t mask,
+                                 const std::function<void(const int16_t*)>& fn) {
+    prepareVadpcm();
+
+    uint32_t chunkNo = offset / chunkSize;
+    uint32_t trackCount = metadata->trackCount;
+    auto history = chunkHistory(chunkNo, preload);
+
+    size_t framesRead;
+    const auto& interleaved = decodeChunk(offset, preload, framesRead);
+
+    // Encoding is the slow part, so it happens before taking the lock
+    thread_local std::vector<uint8_t> encoded;
+    encoded.assign(trackCount * encodedStride, 0);
+
+    for (uint32_t planeNo = 0; planeNo < trackCount; planeNo++) {
+        if (isTrackCached(mask, planeNo)) {
+            Dsp::encodeVadpcmPlane(encoded.data() + planeNo * encodedStride, book, interleaved.data(),
+                                   framesRead, trackCount, planeNo, history.data() + planeNo * 2);
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> cacheLock(cacheMutex);
+
+    storeChunkTail(chunkNo, interleaved, framesRead);
+
+    if (pool.chunkBytes() == 0) {
+        pool.reset(encodedStride / sizeof(int16_t));
+    }
+
+    for (uint32_t planeNo = 0; planeNo < trackCount; planeNo++) {
+        uint32_t key = planeKey(chunkNo, planeNo);
+        if (!isTrackCached(mask, planeNo) || table.find(key) != Cache::ChunkTable::NOT_FOUND) {
+            continue;
+        }
+
+        uint32_t slot = pool.alloc();
+        std::memcpy(pool.data(slot), encoded.data() + planeNo * encodedStride, encodedStride);
+        table.insert(key, slot);
+    }
+
+    if (fn) {
+        fn(findPlane(offset, trackNo));
+    }
+}
+
+// Decodes a chunk and keeps the planes of the tracks in use, plus trackNo when fn wants it. When
+// the compressed tier already has the chunk, it is decompressed instead.
+void Audiofile::loadChunk(size_t offset, bool preload, uint32_t trackNo,
+                          const std::function<void(const int16_t*)>& fn) {
+    uint32_t chunkNo = offset / chunkSize;
+    uint64_t mask = trackMask() | (fn && trackNo < 64 ? 1ull << trackNo : 0);
+    bool tiered;
+
+    if (vadpcm) {
+        return loadEncodedChunk(offset, preload, trackNo, mask, fn);
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> cacheLock(cacheMutex);
+        if (promoteChunk(chunkNo, mask)) {
+            if (fn) {
+                fn(findPlane(offset, trackNo));
+            }
+            return;
+        }
+        tiered = usesColdTier();
+    }
+
+    size_t framesRead;
+    const auto& interleaved = decodeChunk(offset, preload, framesRead);
+    uint32_t trackCount = metadata->trackCount;
+
+    // Every track goes into the compressed tier, so bringing back a muted track never means decoding
+    std::vector<std::vector<uint8_t>> compressed;
+    if (tiered) {
+        thread_local std::vector<int16_t> plane;
+        plane.resize(planeStride);
+        compressed.resize(trackCount);
+
+        for (uint32_t planeNo = 0; planeNo < trackCount; planeNo++) {
+            fillPlane(plane.data(), interleaved, framesRead, planeStride, trackCount, planeNo);
+            Cache::compressPlane(compressed[planeNo], plane.data(), planeStride);
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> cacheLock(cacheMutex);
+
+    for (uint32_t planeNo = 0; planeNo < compressed.size(); planeNo++) {
+        cold.store(planeKey(chunkNo, planeNo), std::move(compressed[planeNo]));
+    }
+
+    // The mapped disk cache is backed by the file rather than the heap, so it keeps every track
+    if (diskCache) {
+        if (!diskCache->has(chunkNo)) {
+            int16_t* chunk = diskCache->data(chunkNo);
+            for (uint32_t planeNo = 0; planeNo < trackCount; planeNo++) {
+                fillPlane(chunk + planeNo * planeStride, interleaved, framesRead, planeStride, trackCount, planeNo);
+            }
+            diskCache->commit(chunkNo);
+        }
+    } else {
+        if (pool.chunkBytes() == 0) {
+            pool.reset(planeStride);
+        }
+
+        for (uint32_t planeNo = 0; planeNo < trackCount; planeNo++) {
+            uint32_t key = planeKey(chunkNo, planeNo);
+            if (!isTrackCached(mask, planeNo) || table.find(key) != Cache::ChunkTable::NOT_FOUND) {
+                continue;
+            }
+
+            uint32_t slot = pool.alloc();
+            fillPlane(pool.data(slot), interleaved, framesRead, planeStride, trackCount, planeNo);
+            table.insert(key, slot);
+        }
+    }
+
+    if (fn) {
+        fn(findPlane(offset, trackNo));
+    }
+}
+
+void Audiofile::dropPlane(uint32_t key) {
+    uint32_t slot = table.erase(key);
+    if (slot != Cache::ChunkTable::NOT_FOUND) {
+        pool.free(slot);
+        dropGeneration.fetch_add(1, std::memory_order_relaxed);
+        Stats::add(stats.evictions, 1);
+        Stats::add(stats.evictedBytes, pool.chunkBytes());
+    }
+}
 
 void Audiofile::dma(uint8_t* rdram, int32_t ptr, size_t offset, size_t count, uint32_t trackNo, uint32_t arg2) {
     if (trackNo >= metadata->trackCount) {
         throw std::invalid_argument("Invalid trackNo " + std::to_string(trackNo));
     }
 
-    size_t chunkOffset, i;
+    uint64_t trackBit = trackNo < 64 ? 1ull << trackNo : 0;
+    if ((requestedTracks.load(std::memory_order_relaxed) & trackBit) != trackBit) {
+        requestedTracks.fetch_or(trackBit, std::memory_order_relaxed);
+    }
+
+    Stats::add(stats.dmaCalls, 1);
 
-    for (chunkOffset = CHUNK_START(offset); chunkOffset < CHUNK_END(offset + count); chunkOffset += CHUNK_SIZE) {
+    if (vadpcm) {
+        return dmaEncoded(rdram, ptr, offset, count, trackNo);
+    }
+
+    Stats::add(stats.bytesServed, count * sizeof(int16_t));
+
+    size_t chunkOffset, start, end;
+    int16_t lastSample = 0;
+
+    auto copy = [&](const int16_t* plane) {
+        Dsp::copyToRdram(rdram, ptr + (start - offset) * 2, plane, start - chunkOffset, end - start);
+        lastSample = plane[(end - 1 - chunkOffset) ^ 1];
+    };
+
+    if (cacheStrategy == CacheStrategy::PreloadOnUseNoBlock && offset > 0) {
+        std::shared_lock<std::shared_mutex> cacheLock(cacheMutex);
+        if (auto plane = findPlane(chunkStart(offset - 1), trackNo)) {
+            lastSample = plane[(offset - 1 - chunkStart(offset - 1)) ^ 1];
+        }
+    }
+
+    for (chunkOffset = chunkStart(offset); chunkOffset < chunkEnd(offset + count); chunkOffset += chunkSize) {
         if (chunkOffset >= metadata->sampleCount) {
             break;
         }
 
-        auto chunk = getChunk(chunkOffset);
-        auto data = chunk->data();
+        start = std::max(chunkOffset, offset);
+        end = std::min(chunkEnd(chunkOffset), offset + count);
 
-        for (i = std::max(chunkOffset, offset); i < std::min(CHUNK_END(chunkOffset), offset + count); i++) {
-            MEM_H(ptr, (i - offset) * 2) = data[(i - chunkOffset) * metadata->trackCount + trackNo];
+        {
+            std::shared_lock<std::shared_mutex> cacheLock(cacheMutex);
+            if (auto plane = findPlane(chunkOffset, trackNo)) {
+                copy(plane);
+                Stats::add(stats.chunkHits, 1);
+                continue;
+            }
         }
+
+        Stats::add(stats.chunkMisses, 1);
+
+        if (gMainThreadId == std::this_thread::get_id()) {
+            PLOG_DEBUG << "Cache miss " << chunkOffset;
+            preemptPreload(chunkDeadline(chunkOffset));
+        }
+
+        // Hold the previous sample and let the preloader catch up, rather than stall the audio thread
+        if (cacheStrategy == CacheStrategy::PreloadOnUseNoBlock) {
+            Dsp::fillRdram(rdram, ptr + (start - offset) * 2, lastSample, end - start);
+            underruns++;
+            continue;
+        }
+
+        Trace::Span span("miss", chunkOffset);
+        loadChunk(chunkOffset, false, trackNo, copy);
     }
 
     pos.store(offset);
+    dmaTime.store(std::chrono::steady_clock::now());
 }
 
-std::vector<PreloadTask> Audiofile::getPreloadTasks() {
+// VADPCM is requested by byte, and every chunk encodes to the same number of bytes. Anything past
+// the end of the file, or not loaded yet when not blocking, reads as silent frames.
+void Audiofile::dmaEncoded(uint8_t* rdram, int32_t ptr, size_t offset, size_t count, uint32_t trackNo) {
+    size_t chunkByte, start, end;
+
+    Stats::add(stats.bytesServed, count);
+
+    auto copy = [&](const int16_t* plane) {
+        Dsp::copyBytesToRdram(rdram, ptr + (start - offset), reinterpret_cast<const uint8_t*>(plane),
+                              start - chunkByte, end - start);
+    };
+
+    auto silence = [&] {
+        for (size_t i = start; i < end; i++) {
+            MEM_B(ptr, i - offset) = 0;
+        }
+    };
+
+    for (chunkByte = offset / encodedStride * encodedStride; chunkByte < offset + count; chunkByte += encodedStride) {
+        size_t chunkOffset = chunkByte / encodedStride * chunkSize;
+
+        start = std::max(chunkByte, offset);
+        end = std::min(chunkByte + encodedStride, offset + count);
+
+        if (chunkOffset >= metadata->sampleCount) {
+            silence();
+            continue;
+        }
+
+        {
+            std::shared_lock<std::shared_mutex> cacheLock(cacheMutex);
+            if (auto plane = findPlane(chunkOffset, trackNo)) {
+                copy(plane);
+                Stats::add(stats.chunkHits, 1);
+                continue;
+            }
+        }
+
+        Stats::add(stats.chunkMisses, 1);
+
+        if (gMainThreadId == std::this_thread::get_id()) {
+            PLOG_DEBUG << "Cache miss " << chunkOffset;
+            preemptPreload(chunkDeadline(chunkOffset));
+        }
+
+        if (cacheStrategy == CacheStrategy::PreloadOnUseNoBlock) {
+            silence();
+            underruns++;
+            continue;
+        }
+
+        Trace::Span span("miss", chunkOffset);
+        loadChunk(chunkOffset, false, trackNo, copy);
+    }
+
+    pos.store(offset / Dsp::VADPCM_FRAME_BYTES * Dsp::VADPCM_FRAME_SAMPLES);
+    dmaTime.store(std::chrono::steady_clock::now());
+}
+
+// Estimates when the audio thread will ask for the chunk at offset. Samples play back from the last
+// DMA position at the sample rate, and are requested about one audio frame before they are played.
+// A paused file resumes no earlier than now.
+Deadline Audiofile::chunkDeadline(size_t offset) const {
+    auto dmaTime = this->dmaTime.load();
+    auto now = std::chrono::steady_clock::now();
+
+    if (dmaTime == EPOCH || metadata->sampleRate == 0) {
+        return now + IDLE_PRELOAD_DELAY;
+    }
+
+    dmaTime = std::max(dmaTime, now - PAUSED_AFTER_TICKS * tickInterval());
+
+    size_t cur = pos.load();
+    size_t ahead;
+
+    if (offset <= cur && cur < offset + chunkSize) {
+        ahead = 0;
+    } else if (offset > cur) {
+        ahead = offset - cur;
+    } else {
+        ahead = (metadata->sampleCount - cur) + (offset - std::min<size_t>(offset, metadata->loopStart));
+    }
+
+    auto playsIn = std::chrono::nanoseconds(ahead * 1'000'000'000ull / metadata->sampleRate);
+    return dmaTime + playsIn - tickInterval();
+}
+
+// Adds tasks for the given number of chunks past the end of the window. False if they don't fit.
+bool Audiofile::extendPreloadWindow(size_t chunks) {
+    for (size_t i = 0; i < chunks; i++) {
+        if (!hasChunk(preloadEnd) &&
+            !preloadTasks.push({ chunkDeadline(preloadEnd), PreloadKind::Chunk, preloadEnd })) {
+            return false;
+        }
+        preloadEnd = nextChunk(preloadEnd);
+    }
+    return true;
+}
+
+// Chunk tasks stay in the heap when playback passes them or dma loads them first, and are skipped
+bool Audiofile::preloadWanted(size_t offset) {
+    size_t dist = chunkDistance(pos.load() / chunkSize, offset / chunkSize);
+    return dist < CACHE_FOLLOWUP_CHUNKS && !hasChunk(offset);
+}
+
+// Deadlines only depend on where a chunk is in the file, as long as playback goes on steadily, so
+// tasks already in the heap stay valid and each update only adds the chunks that came into reach.
+void Audiofile::updatePreloadTasks() {
     if (cacheStrategy == CacheStrategy::None) {
-        return {};
+        return;
     }
 
     if (initialPreload == true) {
         initialPreload = false;
-        return {{ 0, true }};
+        preloadTasks.push({ chunkDeadline(0), PreloadKind::Full });
+        return;
     }
 
+    // The initial load is left over from a preempted run, and still goes first
+    if (!preloadTasks.empty() && preloadTasks.top().kind == PreloadKind::Full) {
+        return;
+    }
+
+    // A preloaded file was decoded in full up front. Only when its PCM is kept compressed does gc
+    // drop chunks, or once an eviction did, and those have to be brought back ahead of playback.
     if (cacheStrategy == CacheStrategy::Preload) {
-        return {};
+        std::shared_lock<std::shared_mutex> cacheLock(cacheMutex);
+        if (!usesColdTier() && dropGeneration.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
     }
 
-    std::vector<PreloadTask> tasks;
-    tasks.reserve(CACHE_FOLLOWUP_CHUNKS);
+    // Starts from the chunk being played, which is only missing after a non-blocking underrun
+    size_t start = chunkStart(pos);
+    uint64_t mask = trackMask();
+    uint64_t generation = dropGeneration.load(std::memory_order_relaxed);
 
-    size_t i, offset = CHUNK_START(pos - 1);
+    size_t moved = 0;
+    bool keep = preloadWindow && mask == preloadMask && generation == preloadGeneration;
 
-    for (i = 1; i <= CACHE_FOLLOWUP_CHUNKS; i++) {
-        offset += CHUNK_SIZE;
-        if (offset >= metadata->sampleCount) {
-            offset = CHUNK_START(metadata->loopStart);
+    for (size_t offset = preloadStart; keep && offset != start; offset = nextChunk(offset)) {
+        keep = ++moved < CACHE_FOLLOWUP_CHUNKS;
+    }
+
+    // After a seek, or once the heap filled up with tasks playback went past
+    if (!keep || !extendPreloadWindow(moved)) {
+        resetPreloadWindow(start);
+    }
+
+    preloadWindow = true;
+    preloadStart = start;
+    preloadMask = mask;
+    preloadGeneration = generation;
+
+    prunePreloadTasks();
+
+    // Playback didn't go on steadily, it was paused or the audio frame time changed, so every
+    // deadline in the heap is off by the same amount. The next task tells by how much.
+    if (!preloadTasks.empty() && preloadTasks.top().offset != start) {
+        const auto& next = preloadTasks.top();
+        if (std::chrono::abs(next.deadline - chunkDeadline(next.offset)) > tickInterval() / 2) {
+            resetPreloadWindow(start);
+            prunePreloadTasks();
         }
-        tasks.emplace_back(i, offset);
     }
+}
+
+void Audiofile::resetPreloadWindow(size_t start) {
+    preloadTasks.clear();
+    preloadEnd = start;
+    extendPreloadWindow(CACHE_FOLLOWUP_CHUNKS);
+}
 
-    return tasks;
+void Audiofile::prunePreloadTasks() {
+    while (!preloadTasks.empty() && !preloadWanted(preloadTasks.top().offset)) {
+        preloadTasks.pop();
+    }
 }
 
 void Audiofile::runPreloadTask(const PreloadTask& task) {
-    if (task.data.type() == typeid(size_t)) {
-        size_t offset = std::any_cast<size_t>(task.data);
-        getChunk(offset);
+    if (task.kind == PreloadKind::Chunk) {
+        if (preloadWanted(task.offset)) {
+            loadChunk(task.offset, true);
+        }
         return;
     }
 
+    attachDiskCache();
+
+    // Metadata supplied by the mod skips probing, so the index is built here instead. Nothing needs
+    // to seek when a previous session already decoded the whole file.
+    bool decoded;
+    {
+        std::shared_lock<std::shared_mutex> cacheLock(cacheMutex);
+        decoded = diskCache && diskCache->complete();
+    }
+    if (!decoded) {
+        std::lock_guard<std::mutex> preloadLock(preloadDecoderMutex);
+        buildSeekIndex(openDecoder(true));
+    }
+
+    if (vadpcm) {
+        prepareVadpcm();
+    }
+
     size_t preloadChunks = cacheStrategy == CacheStrategy::Preload
-        ? numChunks
+        ? numChunks()
         : CACHE_INITIAL_CHUNKS;
 
+    bool tiered;
+    {
+        std::shared_lock<std::shared_mutex> cacheLock(cacheMutex);
+        tiered = usesColdTier();
+    }
+
     for (int i = 0; i < preloadChunks; i++) {
-        size_t offset = CHUNK_START(i * CHUNK_SIZE);
+        size_t offset = chunkStart(i * chunkSize);
         if (offset >= metadata->sampleCount) {
             break;
         }
-        getChunk(offset);
+
+        // Beyond what is about to be played, the file is only kept compressed
+        if (tiered && i >= CACHE_FOLLOWUP_CHUNKS) {
+            compressChunk(offset);
+        } else if (!hasChunk(offset)) {
+            loadChunk(offset, true);
+        }
     }
 
     close();
 }
 
 void Audiofile::gc() {
+    {
+        std::shared_lock<std::shared_mutex> cacheLock(cacheMutex);
+        if (diskCache) {
+            diskCache->sync();
+        }
+    }
+
     auto atime = this->atime.load();
     if (atime == EPOCH) {
         return;
@@ -169,25 +965,108 @@ void Audiofile::gc() {
         return close();
     }
 
-    if (cacheStrategy == CacheStrategy::None || cacheStrategy == CacheStrategy::PreloadOnUse) {
-        std::unique_lock<std::shared_mutex> cacheLock(cacheMutex);
+    // A track counts as active while dma asked for it within the last two intervals. While
+    // nothing is requested at all, such as when paused, the tracks in use stay as they were.
+    uint64_t requested = requestedTracks.exchange(0);
+    uint64_t active = activeTracks.exchange(requested) | requested;
+    if (requested == 0) {
+        activeTracks.store(active);
+    }
+
+    std::unique_lock<std::shared_mutex> cacheLock(cacheMutex);
+
+    // Preloaded files with a compressed copy only keep the PCM around the playback position
+    bool tiered = cacheStrategy == CacheStrategy::Preload && cold.size() > 0;
+
+    if (cacheStrategy == CacheStrategy::None || cacheStrategy == CacheStrategy::PreloadOnUse ||
+        cacheStrategy == CacheStrategy::PreloadOnUseNoBlock || tiered) {
+        size_t curChunk = pos.load() / chunkSize;
+        uint64_t mask = active != 0 ? active : ~0ull;
+        std::vector<uint32_t> expired;
+
+        table.forEach([&](uint32_t key, uint32_t slot) {
+            uint32_t thisChunk = key / metadata->trackCount;
+            size_t dist = chunkDistance(curChunk, thisChunk);
+
+            if (tiered && !cold.has(key)) {
+                return;
+            }
+
+            if (!isTrackCached(mask, key % metadata->trackCount)) {
+                expired.push_back(key);
+            } else if ((thisChunk >= CACHE_INITIAL_CHUNKS) && (dist >= CACHE_FOLLOWUP_CHUNKS) && (dist < numChunks() - 1)) {
+                expired.push_back(key);
+            }
+        });
+
+        for (auto key : expired) {
+            dropPlane(key);
+        }
+    }
+}
+
+size_t Audiofile::cacheSize() {
+    std::shared_lock<std::shared_mutex> cacheLock(cacheMutex);
+    return pool.usedBytes() + cold.usedBytes();
+}
+
+size_t Audiofile::evict(size_t bytes) {
+    if (cacheStrategy == CacheStrategy::PreloadOnUseNoEvict) {
+        return 0;
+    }
+
+    std::unique_lock<std::shared_mutex> cacheLock(cacheMutex);
+
+    size_t curChunk = pos.load() / chunkSize;
+    uint64_t mask = trackMask();
+    std::vector<std::tuple<bool, size_t, uint32_t>> candidates;
+    candidates.reserve(table.size());
 
-        size_t curChunk = pos.load() / CHUNK_SIZE;
+    table.forEach([&](uint32_t key, uint32_t slot) {
+        bool inactive = !isTrackCached(mask, key % metadata->trackCount);
+        candidates.emplace_back(inactive, chunkDistance(curChunk, key / metadata->trackCount), key);
+    });
 
-        auto it = cache.begin();
-        while (it != cache.end()) {
-            size_t thisChunk = it->first / CHUNK_SIZE;
-            size_t dist = (curChunk > thisChunk)
-                ? (numChunks - (curChunk - thisChunk))
-                : (thisChunk - curChunk);
+    // Drop planes of tracks nobody plays first, then the ones that will be needed last
+    std::sort(candidates.begin(), candidates.end(), std::greater<>());
 
-            if ((thisChunk >= CACHE_INITIAL_CHUNKS) && (dist > CACHE_FOLLOWUP_CHUNKS) && (dist < numChunks - 1)) {
-                it = cache.erase(it);
-            } else {
-                it++;
+    size_t freed = 0;
+    for (const auto& [ inactive, dist, key ] : candidates) {
+        if (freed >= bytes) {
+            break;
+        }
+        dropPlane(key);
+        freed += pool.chunkBytes();
+    }
+
+    // Compressed planes go last, since losing them means decoding the chunk again
+    if (freed < bytes && cold.size() > 0) {
+        std::vector<std::tuple<size_t, uint32_t, size_t>> coldCandidates;
+        coldCandidates.reserve(cold.size());
+
+        cold.forEach([&](uint32_t key, size_t size) {
+            coldCandidates.emplace_back(chunkDistance(curChunk, key / metadata->trackCount), key, size);
+        });
+
+        std::sort(coldCandidates.begin(), coldCandidates.end(), std::greater<>());
+
+        for (const auto& [ dist, key, size ] : coldCandidates) {
+            if (freed >= bytes) {
+                break;
             }
+            cold.erase(key);
+            dropGeneration.fetch_add(1, std::memory_order_relaxed);
+            Stats::add(stats.evictions, 1);
+            Stats::add(stats.evictedBytes, size);
+            freed += size;
         }
     }
+
+    return freed;
+}
+
+int Audiofile::evictionWeight() const {
+    return Cache::decodeCost(codec.load());
 }
 
 } // namespace Resource
@@ -9,8 +9,9 @@ constexpr int FILE_TTL_SECONDS = 30;
 Generic::Generic(std::shared_ptr<Vfs::File> file, CacheStrategy cacheStrategy)
     : file(file), cacheStrategy(cacheStrategy) {
 
-    if (cacheStrategy == CacheStrategy::Default) {
-        cacheStrategy = CacheStrategy::PreloadOnUse;
+    // Raw resources have nothing sensible to fill in on a miss, so they always wait for the read
+    if (cacheStrategy == CacheStrategy::Default || cacheStrategy == CacheStrategy::PreloadOnUseNoBlock) {
+        this->cacheStrategy = CacheStrategy::PreloadOnUse;
     }
 }
 
@@ -39,6 +40,9 @@ std::vector<uint8_t> Generic::read(size_t offset, size_t size) {
 }
 
 void Generic::dma(uint8_t* rdram, int32_t ptr, size_t offset, size_t size, uint32_t arg1, uint32_t arg2) {
+    Stats::add(stats.dmaCalls, 1);
+    Stats::add(stats.bytesServed, size);
+
     {
         std::shared_lock cacheLock(cacheMutex);
 
@@ -47,10 +51,13 @@ void Generic::dma(uint8_t* rdram, int32_t ptr, size_t offset, size_t size, uint3
                 MEM_B(ptr, i) = cache[offset + i];
             }
 
+            Stats::add(stats.chunkHits, 1);
             return;
         }
     }
 
+    Stats::add(stats.chunkMisses, 1);
+
     std::vector<uint8_t> buffer = read(offset, size);
 
     for (size_t i = 0; i < size; i++) {
@@ -63,22 +70,27 @@ void Generic::dma(uint8_t* rdram, int32_t ptr, size_t offset, size_t size, uint3
     }
 }
 
-std::vector<PreloadTask> Generic::getPreloadTasks() {
-    if (cacheStrategy == CacheStrategy::None) {
-        return {};
+void Generic::updatePreloadTasks() {
+    // A task left over from a preempted run still does the job
+    if (cacheStrategy == CacheStrategy::None || !preloadTasks.empty()) {
+        return;
     }
 
     if (initialPreload == true) {
         initialPreload = false;
         if (cacheStrategy == CacheStrategy::Preload) {
-            return {{ 0, true }};
+            preloadTasks.push({ Deadline{}, PreloadKind::Full });
         }
     } else if (cacheStrategy == CacheStrategy::PreloadOnUse ||
                cacheStrategy == CacheStrategy::PreloadOnUseNoEvict) {
-        return {{ 0, true }};
+        preloadTasks.push({ Deadline{}, PreloadKind::Full });
+    } else if (cacheStrategy == CacheStrategy::Preload) {
+        // Read again after an eviction, instead of serving every dma from the file
+        std::shared_lock cacheLock(cacheMutex);
+        if (cache.size() < file->size()) {
+            preloadTasks.push({ Deadline{}, PreloadKind::Full });
+        }
     }
-
-    return {};
 }
 
 void Generic::runPreloadTask(const PreloadTask& task) {
@@ -102,10 +114,38 @@ void Generic::gc() {
     auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - atime);
     if (elapsed.count() > FILE_TTL_SECONDS) {
         if (cacheStrategy == CacheStrategy::PreloadOnUse) {
+            std::unique_lock cacheLock(cacheMutex);
+            if (!cache.empty()) {
+                Stats::add(stats.evictions, 1);
+                Stats::add(stats.evictedBytes, cache.size());
+            }
             cache.resize(0);
         }
         return close();
     }
 }
 
+size_t Generic::cacheSize() {
+    std::shared_lock cacheLock(cacheMutex);
+    return cache.size();
+}
+
+// The file is only ever cached whole, so this frees all of it however few bytes are asked for
+size_t Generic::evict(size_t bytes) {
+    if (cacheStrategy == CacheStrategy::PreloadOnUseNoEvict) {
+        return 0;
+    }
+
+    std::unique_lock cacheLock(cacheMutex);
+    size_t freed = cache.size();
+    std::vector<uint8_t>().swap(cache);
+
+    if (freed > 0) {
+        Stats::add(stats.evictions, 1);
+        Stats::add(stats.evictedBytes, freed);
+    }
+
+    return freed;
+}
+
 } // namespace Resource
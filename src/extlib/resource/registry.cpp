@@ -0,0 +1,74 @@
+#include <extlib/resource/registry.hpp>
+
+#include <bit>
+#include <stdexcept>
+
+namespace Resource {
+
+// Segment k holds ids [64 * (2^k - 1), 64 * (2^(k+1) - 1)), so both are found from the bit width of
+// the id offset by the first segment's size
+size_t Registry::segmentOf(size_t id) {
+    return std::bit_width(id + (size_t{1} << FIRST_SEGMENT_BITS)) - 1 - FIRST_SEGMENT_BITS;
+}
+
+size_t Registry::segmentSize(size_t segment) {
+    return size_t{1} << (segment + FIRST_SEGMENT_BITS);
+}
+
+size_t Registry::indexIn(size_t id, size_t segment) {
+    return id + (size_t{1} << FIRST_SEGMENT_BITS) - segmentSize(segment);
+}
+
+const Registry::Slot* Registry::locate(size_t id) const {
+    size_t segment = segmentOf(id);
+    if (segment >= SEGMENTS) {
+        return nullptr;
+    }
+
+    const Slot* slots = segments[segment].load(std::memory_order_acquire);
+    return slots ? &slots[indexIn(id, segment)] : nullptr;
+}
+
+size_t Registry::add(ResourcePtr resource) {
+    size_t id = next.fetch_add(1, std::memory_order_acq_rel);
+    size_t segment = segmentOf(id);
+
+    if (segment >= SEGMENTS) {
+        throw std::runtime_error("Too many resources");
+    }
+
+    // Whoever needs a segment first allocates it, and anyone who loses the race frees theirs
+    Slot* slots = segments[segment].load(std::memory_order_acquire);
+    if (slots == nullptr) {
+        Slot* fresh = new Slot[segmentSize(segment)];
+        if (segments[segment].compare_exchange_strong(slots, fresh, std::memory_order_acq_rel)) {
+            slots = fresh;
+        } else {
+            delete[] fresh;
+        }
+    }
+
+    Slot& slot = slots[indexIn(id, segment)];
+    slot.resource = std::move(resource);
+    slot.ready.store(true, std::memory_order_release);
+
+    return id;
+}
+
+Abstract* Registry::find(size_t id) const {
+    const Slot* slot = locate(id);
+    if (slot == nullptr || !slot->ready.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return slot->resource.get();
+}
+
+ResourcePtr Registry::get(size_t id) const {
+    const Slot* slot = locate(id);
+    if (slot == nullptr || !slot->ready.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return slot->resource;
+}
+
+} // namespace Resource
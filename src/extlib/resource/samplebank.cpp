@@ -7,8 +7,8 @@ namespace Resource {
 SampleBank::SampleBank(std::shared_ptr<Vfs::File> file, CacheStrategy cacheStrategy)
     : Generic(file, cacheStrategy) {
 
-    if (cacheStrategy == CacheStrategy::Default) {
-        cacheStrategy = CacheStrategy::PreloadOnUse;
+    if (cacheStrategy == CacheStrategy::Default || cacheStrategy == CacheStrategy::PreloadOnUseNoBlock) {
+        this->cacheStrategy = CacheStrategy::PreloadOnUse;
     }
 }
 
@@ -17,6 +17,9 @@ SampleBank::~SampleBank() {
 }
 
 void SampleBank::dma(uint8_t* rdram, int32_t ptr, size_t offset, size_t size, uint32_t devAddr, uint32_t arg2) {
+    Stats::add(stats.dmaCalls, 1);
+    Stats::add(stats.bytesServed, size);
+
     {
         std::shared_lock cacheLock(cacheMutex);
 
@@ -25,10 +28,13 @@ void SampleBank::dma(uint8_t* rdram, int32_t ptr, size_t offset, size_t size, ui
                 MEM_B(ptr, i) = cache[offset + devAddr + i];
             }
 
+            Stats::add(stats.chunkHits, 1);
             return;
         }
     }
 
+    Stats::add(stats.chunkMisses, 1);
+
     std::vector<uint8_t> buffer = read(offset + devAddr, size);
 
     for (size_t i = 0; i < size; i++) {
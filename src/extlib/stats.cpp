@@ -0,0 +1,130 @@
+#include <extlib/stats.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+
+#include <plog/Log.h>
+
+#include <extlib/main.hpp>
+#include <extlib/resource/abstract.hpp>
+#include <extlib/utils.hpp>
+
+namespace Stats {
+
+constexpr auto SUMMARY_INTERVAL = std::chrono::seconds(30);
+
+constexpr const char* CODEC_NAMES[CODECS] = { "auto", "wav", "flac", "mp3", "vorbis", "opus", "pack" };
+
+Global gStats;
+
+static Snapshot sLastSummary;
+static std::chrono::steady_clock::time_point sLastSummaryTime = EPOCH;
+static std::mutex sSummaryMutex;
+
+void recordDecode(uint32_t codec, size_t frames, std::chrono::nanoseconds elapsed) {
+    if (codec >= CODECS) {
+        return;
+    }
+    add(gStats.decodeNs[codec], elapsed.count());
+    add(gStats.decodeFrames[codec], frames);
+}
+
+void recordQueueDepth(size_t depth) {
+    gStats.queueDepth.store(depth, std::memory_order_relaxed);
+
+    size_t max = gStats.queueDepthMax.load(std::memory_order_relaxed);
+    while (depth > max && !gStats.queueDepthMax.compare_exchange_weak(max, depth, std::memory_order_relaxed)) {}
+}
+
+static void addCounters(Snapshot& snapshot, Resource::Abstract& resource) {
+    const auto& counters = resource.stats;
+
+    snapshot.dmaCalls += counters.dmaCalls.load(std::memory_order_relaxed);
+    snapshot.bytesServed += counters.bytesServed.load(std::memory_order_relaxed);
+    snapshot.chunkHits += counters.chunkHits.load(std::memory_order_relaxed);
+    snapshot.chunkMisses += counters.chunkMisses.load(std::memory_order_relaxed);
+    snapshot.mainThreadDecodeNs += counters.mainThreadDecodeNs.load(std::memory_order_relaxed);
+    snapshot.evictions += counters.evictions.load(std::memory_order_relaxed);
+    snapshot.evictedBytes += counters.evictedBytes.load(std::memory_order_relaxed);
+    snapshot.underruns += resource.underruns.load(std::memory_order_relaxed);
+    snapshot.cacheBytes += resource.cacheSize();
+}
+
+Snapshot collect(int64_t resourceId) {
+    Snapshot snapshot;
+
+    if (resourceId < 0) {
+        gResources.forEach([&](size_t id, const Resource::ResourcePtr& resource) {
+            addCounters(snapshot, *resource);
+        });
+    } else if (auto resource = gResources.find(static_cast<size_t>(resourceId))) {
+        addCounters(snapshot, *resource);
+    }
+
+    snapshot.queueDepth = gStats.queueDepth.load(std::memory_order_relaxed);
+    snapshot.queueDepthMax = gStats.queueDepthMax.load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i < CODECS; i++) {
+        snapshot.decodeNs[i] = gStats.decodeNs[i].load(std::memory_order_relaxed);
+        snapshot.decodeFrames[i] = gStats.decodeFrames[i].load(std::memory_order_relaxed);
+    }
+
+    return snapshot;
+}
+
+void toAudioApiStats(const Snapshot& snapshot, AudioApiStats* out) {
+    out->dmaCalls = static_cast<uint32_t>(snapshot.dmaCalls);
+    out->bytesServed = static_cast<uint32_t>(snapshot.bytesServed);
+    out->chunkHits = static_cast<uint32_t>(snapshot.chunkHits);
+    out->chunkMisses = static_cast<uint32_t>(snapshot.chunkMisses);
+    out->underruns = static_cast<uint32_t>(snapshot.underruns);
+    out->mainThreadDecodeUs = static_cast<uint32_t>(snapshot.mainThreadDecodeNs / 1000);
+    out->evictions = static_cast<uint32_t>(snapshot.evictions);
+    out->evictedBytes = static_cast<uint32_t>(snapshot.evictedBytes);
+    out->cacheBytes = static_cast<uint32_t>(std::min<uint64_t>(snapshot.cacheBytes, UINT32_MAX));
+    out->queueDepth = static_cast<uint32_t>(snapshot.queueDepth);
+    out->queueDepthMax = static_cast<uint32_t>(snapshot.queueDepthMax);
+
+    for (size_t i = 0; i < CODECS; i++) {
+        out->decodeUs[i] = static_cast<uint32_t>(snapshot.decodeNs[i] / 1000);
+        out->decodeFrames[i] = static_cast<uint32_t>(snapshot.decodeFrames[i]);
+    }
+}
+
+void logSummary() {
+    std::lock_guard<std::mutex> lock(sSummaryMutex);
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - sLastSummaryTime < SUMMARY_INTERVAL) {
+        return;
+    }
+
+    Snapshot cur = collect(-1);
+    const Snapshot& last = sLastSummary;
+
+    if (cur.dmaCalls == last.dmaCalls) {
+        return;
+    }
+
+    std::ostringstream codecs;
+    for (size_t i = 0; i < CODECS; i++) {
+        if (cur.decodeFrames[i] != last.decodeFrames[i]) {
+            codecs << " " << CODEC_NAMES[i] << " " << (cur.decodeNs[i] - last.decodeNs[i]) / 1'000'000 << "ms";
+        }
+    }
+
+    PLOG_INFO << "Stats: " << cur.dmaCalls - last.dmaCalls << " dma, "
+              << cur.chunkHits - last.chunkHits << " hits, "
+              << cur.chunkMisses - last.chunkMisses << " misses, "
+              << cur.underruns - last.underruns << " underruns, "
+              << (cur.mainThreadDecodeNs - last.mainThreadDecodeNs) / 1'000'000 << "ms main thread decode, "
+              << cur.evictions - last.evictions << " evictions, "
+              << cur.cacheBytes / (1024 * 1024) << "MiB cached, "
+              << "queue " << cur.queueDepth << "/" << cur.queueDepthMax << ", decode" << codecs.str();
+
+    sLastSummary = cur;
+    sLastSummaryTime = now;
+}
+
+} // namespace Stats
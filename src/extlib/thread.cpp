@@ -1,21 +1,28 @@
 #include <extlib/thread.hpp>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
-#include <unordered_set>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include <plog/Log.h>
 
 #include <extlib/main.hpp>
 #include <extlib/resource/abstract.hpp>
+#include <extlib/stats.hpp>
+#include <extlib/trace.hpp>
 #include <extlib/utils.hpp>
 
 constexpr int GC_INTERVAL_SECONDS = 1;
+constexpr size_t MAX_WORKERS = 16;
+constexpr auto DEFAULT_TICK_INTERVAL = std::chrono::nanoseconds(1'000'000'000 / 60);
 
 std::thread::id gMainThreadId = std::this_thread::get_id();
 std::thread::id gWorkerThreadId;
@@ -23,10 +30,103 @@ std::thread::id gWorkerThreadId;
 static std::condition_variable sWorkerThreadSignal;
 static std::mutex sWorkerThreadMutex;
 
-static std::unordered_set<size_t> sPreloadRequests;
-static std::mutex sPreloadMutex;
+constexpr size_t PRELOAD_QUEUE_SIZE = 4096;
+
+// Bounded multi-producer queue of resource ids, after Vyukov's: each cell's sequence number says
+// whether it is free for the producer at that position or holds a value for the consumer. Only the
+// scheduler thread pops.
+class PreloadQueue {
+public:
+    PreloadQueue() {
+        for (size_t i = 0; i < PRELOAD_QUEUE_SIZE; i++) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(size_t resourceId) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+
+        while (true) {
+            auto& cell = cells[pos & (PRELOAD_QUEUE_SIZE - 1)];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.resourceId = resourceId;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(size_t& resourceId) {
+        auto& cell = cells[head & (PRELOAD_QUEUE_SIZE - 1)];
+
+        if (cell.seq.load(std::memory_order_acquire) != head + 1) {
+            return false;
+        }
+
+        resourceId = cell.resourceId;
+        cell.seq.store(head + PRELOAD_QUEUE_SIZE, std::memory_order_release);
+        head++;
+        return true;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> seq;
+        size_t resourceId;
+    };
+
+    std::array<Cell, PRELOAD_QUEUE_SIZE> cells;
+    alignas(64) std::atomic<size_t> tail = 0;
+    alignas(64) size_t head = 0;
+};
+
+static PreloadQueue sPreloadQueue;
+
+// Requests that didn't fit, which takes more resources waiting at once than the queue holds
+static std::vector<size_t> sPreloadOverflow;
+static std::mutex sPreloadOverflowMutex;
+static std::atomic<bool> sHasPreloadOverflow = false;
 
 static std::chrono::steady_clock::time_point sLastGc = EPOCH;
+static std::chrono::steady_clock::time_point sLastTick = EPOCH;
+static std::atomic<int64_t> sTickInterval = DEFAULT_TICK_INTERVAL.count();
+static std::atomic<uint32_t> sPreemptGeneration = 0;
+static std::atomic<int64_t> sPreemptDeadline = 0;
+
+// The preload tasks of one resource, which run from its heap in deadline order on a single decode
+// worker. The deadline is that of the first task when the job was queued.
+struct PreloadJob {
+    size_t resourceId;
+    Resource::ResourcePtr resource;
+    Resource::Deadline deadline;
+};
+
+struct DecodeWorker {
+    std::deque<PreloadJob> jobs;
+    std::mutex mutex;
+};
+
+static std::array<DecodeWorker, MAX_WORKERS> sDecodeWorkers;
+static std::atomic<size_t> sDecodeWorkerCount = 0;
+static size_t sDecodeWorkerTarget = std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, 4);
+static std::mutex sDecodeWorkerMutex;
+static bool sDecodeWorkersStarted = false;
+
+// Decode workers are detached and block on this forever, so it is never destroyed. Tearing it down
+// at exit while they wait on it would hang the process.
+static std::condition_variable& sJobSignal = *new std::condition_variable;
+static std::mutex sJobMutex;
+static std::atomic<size_t> sQueuedJobs = 0;
+static size_t sNextWorker = 0;
 
 
 void drainPreload();
@@ -36,8 +136,49 @@ void workerThreadNotify() {
     sWorkerThreadSignal.notify_one();
 }
 
+// Called once per audio frame. Keeps a moving average of the frame time, which tells the scheduler
+// how far ahead of playback the audio thread requests samples.
+void workerThreadTick() {
+    auto now = std::chrono::steady_clock::now();
+
+    if (sLastTick != EPOCH) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - sLastTick).count();
+        if (elapsed < std::chrono::nanoseconds(std::chrono::seconds(1)).count()) {
+            auto interval = sTickInterval.load();
+            sTickInterval.store(interval + (elapsed - interval) / 8);
+        }
+    }
+
+    sLastTick = now;
+    workerThreadNotify();
+}
+
+std::chrono::nanoseconds tickInterval() {
+    return std::chrono::nanoseconds(sTickInterval.load());
+}
+
+// The audio thread had to decode a chunk itself, so the schedule is behind. Running jobs whose next
+// task is due later than the missed chunk stop after their current one, and are planned again with
+// fresh deadlines. Jobs that are already working on something more urgent carry on.
+void preemptPreload(std::chrono::steady_clock::time_point deadline) {
+    sPreemptDeadline.store(deadline.time_since_epoch().count());
+    sPreemptGeneration++;
+    workerThreadNotify();
+}
+
+static bool preempted(uint32_t& generation, Resource::Deadline next) {
+    uint32_t current = sPreemptGeneration.load();
+    if (current == generation) {
+        return false;
+    }
+
+    generation = current;
+    return next > Resource::Deadline(Resource::Deadline::duration(sPreemptDeadline.load()));
+}
+
 void workerThreadLoop() {
     gWorkerThreadId = std::this_thread::get_id();
+    Trace::setThreadName("scheduler");
 
     while (true) {
         {
@@ -56,55 +197,212 @@ void workerThreadLoop() {
     }
 }
 
+// Called on every DMA. Once a resource is queued, asking again is a single atomic exchange.
 void queuePreload(size_t resourceId) {
-    std::unique_lock<std::mutex> preloadLock(sPreloadMutex);
-    sPreloadRequests.insert(resourceId);
+    auto resource = gResources.find(resourceId);
+    if (resource == nullptr || resource->preloadQueued.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    if (!sPreloadQueue.push(resourceId)) {
+        std::unique_lock<std::mutex> lock(sPreloadOverflowMutex);
+        sPreloadOverflow.push_back(resourceId);
+        sHasPreloadOverflow.store(true, std::memory_order_release);
+    }
 }
 
-void drainPreload() {
-    std::unordered_set<size_t> preloadRequests;
-    std::vector<std::pair<Resource::ResourcePtr, Resource::PreloadTask>> tasks;
+static void pushJob(PreloadJob&& job) {
+    size_t count = sDecodeWorkerCount.load();
+    auto& worker = sDecodeWorkers[sNextWorker++ % count];
 
+    // Counted before it can be popped, so the count never drops below the jobs actually queued
     {
-        std::unique_lock<std::mutex> preloadLock(sPreloadMutex);
-        preloadRequests.merge(sPreloadRequests);
+        std::unique_lock<std::mutex> lock(sJobMutex);
+        Stats::recordQueueDepth(++sQueuedJobs);
     }
-
     {
-        std::shared_lock<std::shared_mutex> resourceLock(gResourceDataMutex);
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        auto it = std::upper_bound(worker.jobs.begin(), worker.jobs.end(), job.deadline,
+                                   [](const auto& deadline, const auto& other) {
+            return deadline < other.deadline;
+        });
+        worker.jobs.insert(it, std::move(job));
+    }
 
-        for (const auto& resourceId : preloadRequests) {
-            auto it = gResourceData.find(resourceId);
-            if (it == gResourceData.end()) {
-                continue;
-            }
+    sJobSignal.notify_one();
+}
 
-            auto resource = it->second;
-            for (const auto& task : resource->getPreloadTasks()) {
-                tasks.emplace_back(resource, task);
-            }
+// Takes the most urgent job of the worker's own deque, which is kept sorted. Only when that is empty
+// does it steal the most urgent job of the next worker that has any.
+static std::optional<PreloadJob> popJob(size_t workerNo) {
+    size_t count = sDecodeWorkerCount.load();
+
+    for (size_t i = 0; i < count; i++) {
+        auto& worker = sDecodeWorkers[(workerNo + i) % count];
+        std::unique_lock<std::mutex> lock(worker.mutex);
+
+        if (!worker.jobs.empty()) {
+            PreloadJob job = std::move(worker.jobs.front());
+            worker.jobs.pop_front();
+            Stats::recordQueueDepth(--sQueuedJobs);
+            return job;
         }
     }
 
-    std::sort(tasks.begin(), tasks.end(), [](const auto& a, const auto& b) {
-        return a.second.priority < b.second.priority;
-    });
+    return std::nullopt;
+}
+
+static void runJob(const PreloadJob& job) {
+    uint32_t generation = sPreemptGeneration.load();
+
+    auto& tasks = job.resource->preloadTasks;
+
+    // Whatever is left when preempted stays in the heap for the next run
+    while (!tasks.empty()) {
+        if (preempted(generation, tasks.top().deadline)) {
+            queuePreload(job.resourceId);
+            break;
+        }
+
+        auto task = tasks.pop();
 
-    for (const auto& [ resource, task ] : tasks) {
         try {
-            resource->runPreloadTask(task);
+            Trace::Span span("preload", job.resourceId);
+            job.resource->runPreloadTask(task);
         } catch (const std::runtime_error& e) {
             PLOG_ERROR << "Error running preload task: " << e.what();
         } catch (...) {
             PLOG_ERROR << "Error running preload task: Unknown error";
         }
     }
+
+    job.resource->preloadRunning.store(false);
+}
+
+static void decodeWorkerLoop(size_t workerNo) {
+    Trace::setThreadName("decode " + std::to_string(workerNo));
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(sJobMutex);
+            sJobSignal.wait(lock, [] { return sQueuedJobs.load() > 0; });
+        }
+
+        if (auto job = popJob(workerNo)) {
+            runJob(*job);
+        }
+    }
+}
+
+static void spawnDecodeWorkers(size_t count) {
+    for (size_t i = sDecodeWorkerCount.load(); i < count; i++) {
+        std::thread thread(decodeWorkerLoop, i);
+        thread.detach();
+        sDecodeWorkerCount++;
+    }
+}
+
+void workerPoolStart() {
+    std::unique_lock<std::mutex> lock(sDecodeWorkerMutex);
+    spawnDecodeWorkers(sDecodeWorkerTarget);
+    sDecodeWorkersStarted = true;
+}
+
+void setWorkerCount(size_t count) {
+    std::unique_lock<std::mutex> lock(sDecodeWorkerMutex);
+    sDecodeWorkerTarget = std::clamp<size_t>(count, 1, MAX_WORKERS);
+
+    if (sDecodeWorkersStarted) {
+        if (sDecodeWorkerTarget < sDecodeWorkerCount.load()) {
+            PLOG_WARNING << "Decode workers cannot be removed once started";
+        }
+        spawnDecodeWorkers(sDecodeWorkerTarget);
+    }
+}
+
+// Runs fn once for every index on short lived helper threads plus the caller, and returns when all
+// are done. Meant for one-off bursts like registering files, which should not queue up behind
+// preloading. fn must not throw.
+void parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    std::atomic<size_t> next = 0;
+    size_t threadCount = std::min(count, std::clamp<size_t>(std::thread::hardware_concurrency(), 1, MAX_WORKERS));
+
+    auto run = [&] {
+        for (size_t i = next++; i < count; i = next++) {
+            fn(i);
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < threadCount; i++) {
+        helpers.emplace_back(run);
+    }
+
+    run();
+
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+}
+
+void drainPreload() {
+    // Only ever used by the scheduler thread, and kept to avoid allocating every tick
+    static std::vector<size_t> preloadRequests;
+    static std::vector<PreloadJob> jobs;
+
+    // Taken all at once, since requests queued again below belong to the next tick
+    size_t resourceId;
+    preloadRequests.clear();
+    while (sPreloadQueue.pop(resourceId)) {
+        preloadRequests.push_back(resourceId);
+    }
+
+    if (sHasPreloadOverflow.load(std::memory_order_acquire)) {
+        std::unique_lock<std::mutex> lock(sPreloadOverflowMutex);
+        preloadRequests.insert(preloadRequests.end(), sPreloadOverflow.begin(), sPreloadOverflow.end());
+        sPreloadOverflow.clear();
+        sHasPreloadOverflow.store(false, std::memory_order_relaxed);
+    }
+
+    for (size_t resourceId : preloadRequests) {
+        auto resource = gResources.get(resourceId);
+        if (!resource) {
+            continue;
+        }
+
+        // Cleared before looking at the resource, so a request arriving from now on isn't lost
+        resource->preloadQueued.store(false, std::memory_order_release);
+
+        // Keep one decoder reading sequentially, and try again next tick
+        if (resource->preloadRunning.exchange(true)) {
+            queuePreload(resourceId);
+            continue;
+        }
+
+        resource->updatePreloadTasks();
+        if (resource->preloadTasks.empty()) {
+            resource->preloadRunning.store(false);
+            continue;
+        }
+
+        auto deadline = resource->preloadTasks.top().deadline;
+        jobs.push_back({ resourceId, std::move(resource), deadline });
+    }
+
+    for (auto& job : jobs) {
+        pushJob(std::move(job));
+    }
+    jobs.clear();
 }
 
 void gc() {
-    std::shared_lock<std::shared_mutex> lock(gResourceDataMutex);
+    Trace::Span span("gc");
 
-    for (const auto& [ resourceId, resource ] : gResourceData) {
+    gResources.forEach([](size_t resourceId, const Resource::ResourcePtr& resource) {
         resource->gc();
-    }
+    });
+
+    gCacheManager.enforce();
+    gProbeIndex.save();
+    Stats::logSummary();
 }
@@ -0,0 +1,112 @@
+// Converts WAV/FLAC/MP3/Vorbis/Opus files into native PCM packs (.apcm), which the extlib plays
+// back without decoding. Loop points found in the source are carried over into the header. With
+// --rate the audio is resampled first, 32000 lets the game play it at a tuning of 1.0.
+//
+// usage: audioapi_pack [--rate <hz>] <input> <output.apcm>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <extlib/decoder/abstract.hpp>
+#include <extlib/decoder/pack.hpp>
+#include <extlib/decoder/resampled.hpp>
+#include <extlib/vfs/native_file.hpp>
+
+static size_t alignUp(size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+}
+
+static void pack(const fs::path& input, const fs::path& output, uint32_t rate) {
+    auto file = std::make_shared<Vfs::NativeFile>(input);
+    auto decoder = Decoder::factory(file);
+
+    if (rate != 0) {
+        decoder = std::make_unique<Decoder::Resampled>(file, std::move(decoder), rate);
+    }
+
+    file->open();
+    decoder->open();
+    decoder->probe();
+
+    const auto& metadata = *decoder->metadata;
+
+    Decoder::PackHeader header;
+    header.trackCount = metadata.trackCount;
+    header.sampleRate = metadata.sampleRate;
+    header.sampleCount = metadata.sampleCount;
+    header.loopStart = metadata.loopStart;
+    header.loopEnd = metadata.loopEnd;
+    header.loopCount = metadata.loopCount;
+    header.dataOffset = Decoder::PACK_ALIGN;
+    header.planeStride = alignUp(static_cast<size_t>(metadata.sampleCount) * sizeof(int16_t), Decoder::PACK_ALIGN);
+
+    std::vector<uint8_t> data(header.dataOffset + static_cast<size_t>(header.trackCount) * header.planeStride);
+    std::vector<int16_t> interleaved(Decoder::DEFAULT_CHUNK_SIZE * header.trackCount);
+    size_t offset = 0;
+
+    while (offset < metadata.sampleCount) {
+        size_t framesRead = decoder->decode(&interleaved, Decoder::DEFAULT_CHUNK_SIZE, offset);
+        if (framesRead == 0) {
+            break;
+        }
+
+        for (size_t trackNo = 0; trackNo < header.trackCount; trackNo++) {
+            uint8_t* plane = data.data() + header.dataOffset + trackNo * header.planeStride + offset * sizeof(int16_t);
+            for (size_t i = 0; i < framesRead; i++) {
+                uint16_t sample = interleaved[i * header.trackCount + trackNo];
+                plane[i * 2] = sample >> 8;
+                plane[i * 2 + 1] = sample & 0xFF;
+            }
+        }
+
+        offset += framesRead;
+    }
+
+    // Some codecs report a slightly longer stream than they actually decode
+    if (offset < header.sampleCount) {
+        std::fprintf(stderr, "warning: %s: decoded %zu of %u frames\n", input.string().c_str(), offset, header.sampleCount);
+        header.sampleCount = offset;
+        header.loopEnd = std::min<uint32_t>(header.loopEnd, offset);
+    }
+
+    header.serialize(data.data());
+
+    std::ofstream stream(output, std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!stream) {
+        throw std::runtime_error("Could not write file: " + output.string());
+    }
+
+    std::printf("%s: %u tracks, %u Hz, %u frames, loop %u-%u (%d)\n", output.string().c_str(), header.trackCount,
+                header.sampleRate, header.sampleCount, header.loopStart, header.loopEnd, header.loopCount);
+}
+
+int main(int argc, char** argv) {
+    uint32_t rate = 0;
+    int arg = 1;
+
+    if (argc == 5 && std::string(argv[1]) == "--rate") {
+        rate = std::strtoul(argv[2], nullptr, 10);
+        arg = 3;
+    }
+
+    if (argc - arg != 2) {
+        std::fprintf(stderr, "usage: %s [--rate <hz>] <input> <output.apcm>\n", argv[0]);
+        return 1;
+    }
+
+    try {
+        pack(argv[arg], argv[arg + 1], rate);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
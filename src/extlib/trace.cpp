@@ -0,0 +1,209 @@
+#include <extlib/trace.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Trace {
+
+constexpr size_t RING_SIZE = 1 << 16;
+constexpr size_t RING_MASK = RING_SIZE - 1;
+
+// Written like a seqlock: seq is odd while a writer fills the slot in, and even with the event's
+// position once it is done, so the reader can skip slots that were torn or overwritten.
+struct Event {
+    std::atomic<uint64_t> seq = 0;
+    std::atomic<const char*> name = nullptr;
+    std::atomic<uint64_t> start = 0;
+    std::atomic<uint64_t> end = 0;
+    std::atomic<uint64_t> arg = 0;
+    std::atomic<uint32_t> tid = 0;
+};
+
+std::atomic<bool> enabled = false;
+
+// Allocated on first start and never freed, since detached workers may still be recording at exit
+static std::atomic<Event*> sRing = nullptr;
+static std::atomic<uint64_t> sHead = 0;
+static std::atomic<uint64_t> sStartTime = 0;
+
+static std::mutex sMutex;
+static fs::path sOutputPath;
+static std::vector<std::pair<uint32_t, std::string>> sThreadNames;
+static bool sExitHandlerSet = false;
+
+static std::atomic<uint32_t> sNextThreadId = 1;
+static thread_local uint32_t tThreadId = 0;
+
+static uint32_t threadId() {
+    if (tThreadId == 0) {
+        tThreadId = sNextThreadId++;
+    }
+    return tThreadId;
+}
+
+uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void record(const char* name, uint64_t start, uint64_t end, uint64_t arg) {
+    Event* ring = sRing.load(std::memory_order_acquire);
+    if (ring == nullptr) {
+        return;
+    }
+
+    uint64_t pos = sHead.fetch_add(1, std::memory_order_relaxed);
+    auto& event = ring[pos & RING_MASK];
+
+    event.seq.store(pos * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(start, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    event.arg.store(arg, std::memory_order_relaxed);
+    event.tid.store(threadId(), std::memory_order_relaxed);
+
+    event.seq.store(pos * 2 + 2, std::memory_order_release);
+}
+
+void setThreadName(std::string name) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    uint32_t tid = threadId();
+
+    for (auto& [ id, threadName ] : sThreadNames) {
+        if (id == tid) {
+            threadName = std::move(name);
+            return;
+        }
+    }
+
+    sThreadNames.emplace_back(tid, std::move(name));
+}
+
+void setOutputPath(fs::path path) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    sOutputPath = std::move(path);
+}
+
+static void writeAtExit() {
+    if (enabled.load()) {
+        stop();
+    }
+}
+
+void start() {
+    setThreadName("main");
+
+    std::lock_guard<std::mutex> lock(sMutex);
+
+    if (sRing.load() == nullptr) {
+        sRing.store(new Event[RING_SIZE], std::memory_order_release);
+    }
+
+    Event* ring = sRing.load();
+    for (size_t i = 0; i < RING_SIZE; i++) {
+        ring[i].seq.store(0, std::memory_order_relaxed);
+    }
+
+    sHead.store(0);
+    sStartTime.store(now());
+
+    if (!sExitHandlerSet) {
+        std::atexit(writeAtExit);
+        sExitHandlerSet = true;
+    }
+
+    enabled.store(true);
+}
+
+bool stop() {
+    enabled.store(false);
+
+    fs::path path;
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        path = sOutputPath;
+    }
+
+    return !path.empty() && write(path);
+}
+
+bool write(const fs::path& path) {
+    struct Copy {
+        const char* name;
+        uint64_t start, end, arg;
+        uint32_t tid;
+    };
+
+    Event* ring = sRing.load(std::memory_order_acquire);
+    if (ring == nullptr) {
+        return false;
+    }
+
+    std::vector<Copy> events;
+    uint64_t head = sHead.load(std::memory_order_acquire);
+    uint64_t startTime = sStartTime.load();
+
+    events.reserve(std::min<uint64_t>(head, RING_SIZE));
+
+    for (uint64_t pos = head > RING_SIZE ? head - RING_SIZE : 0; pos < head; pos++) {
+        auto& event = ring[pos & RING_MASK];
+
+        uint64_t seq = event.seq.load(std::memory_order_acquire);
+        if (seq != pos * 2 + 2) {
+            continue;
+        }
+
+        Copy copy = {
+            event.name.load(std::memory_order_relaxed),
+            event.start.load(std::memory_order_relaxed),
+            event.end.load(std::memory_order_relaxed),
+            event.arg.load(std::memory_order_relaxed),
+            event.tid.load(std::memory_order_relaxed),
+        };
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (event.seq.load(std::memory_order_relaxed) != seq || copy.start < startTime) {
+            continue;
+        }
+
+        events.push_back(copy);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"audio api\"}}";
+
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        for (const auto& [ tid, name ] : sThreadNames) {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+                << ",\"args\":{\"name\":\"" << name << "\"}}";
+        }
+    }
+
+    char buffer[64];
+    for (const auto& event : events) {
+        std::snprintf(buffer, sizeof(buffer), "\"ts\":%.3f,\"dur\":%.3f",
+                      (event.start - startTime) / 1000.0, (event.end - event.start) / 1000.0);
+
+        out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"audioapi\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+            << event.tid << "," << buffer << ",\"args\":{\"arg\":" << event.arg << "}}";
+    }
+
+    out << "\n]}\n";
+    return out.good();
+}
+
+} // namespace Trace
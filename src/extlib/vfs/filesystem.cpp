@@ -70,11 +70,16 @@ bool Filesystem::isZipFile(fs::path path) {
     return isZip;
 }
 
-std::shared_ptr<File> Filesystem::openFile(std::u8string baseDirStr, std::u8string pathStr) {
+fs::path Filesystem::resolveBaseDir(std::u8string baseDirStr) {
     auto baseDir = fs::path(baseDirStr).lexically_normal();
     if (baseDir.is_relative() || baseDirStr.empty()) {
         baseDir = defaultDir / baseDir;
     }
+    return baseDir;
+}
+
+std::shared_ptr<File> Filesystem::openFile(std::u8string baseDirStr, std::u8string pathStr) {
+    auto baseDir = resolveBaseDir(baseDirStr);
 
     if (!isPathAllowed(baseDir)) {
         throw std::filesystem::filesystem_error("Base dir is not an allowed path", baseDir, std::error_code());
@@ -90,4 +90,15 @@ int64_t NativeFile::tell() {
     return pos;
 }
 
+std::shared_ptr<File> NativeFile::clone() const {
+    return std::make_shared<NativeFile>(path);
+}
+
+// Modification time, together with the size checked by the caller
+uint64_t NativeFile::fingerprint() const {
+    std::error_code ec;
+    auto mtime = fs::last_write_time(path, ec);
+    return ec ? 0 : static_cast<uint64_t>(mtime.time_since_epoch().count());
+}
+
 } // namespace Vfs
@@ -107,6 +107,7 @@ ZipArchive::FileInfo ZipArchive::locateFile(std::string path) {
     }
 
     auto info = FileInfo{ index, stat.m_uncomp_size };
+    info.crc32 = stat.m_crc32;
 
     if (stat.m_comp_size == stat.m_uncomp_size) {
         char localDirHeader[30];
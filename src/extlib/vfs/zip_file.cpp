@@ -1,5 +1,7 @@
 #include <extlib/vfs/zip_file.hpp>
 
+#include <extlib/trace.hpp>
+
 namespace Vfs {
 
 ZipFile::ZipFile(std::shared_ptr<ZipArchive> archive, fs::path path)
@@ -13,17 +15,30 @@ ZipFile::~ZipFile() {
 }
 
 void ZipFile::open() {
-    if (info.compressed && buffer.size() == 0) {
-        std::lock_guard<std::mutex> lock(mutex);
-        archive->extractFileToBuffer(path.string(), buffer);
+    if (!info.compressed) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (buffer) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> inflatedLock(inflated->mutex);
+    buffer = inflated->buffer.lock();
+
+    if (!buffer) {
+        Trace::Span span("inflate", info.size);
+        auto data = std::make_shared<std::vector<uint8_t>>();
+        archive->extractFileToBuffer(path.string(), *data);
+        inflated->buffer = data;
+        buffer = std::move(data);
     }
 }
 
 void ZipFile::close() {
-    if (info.compressed) {
-        std::lock_guard<std::mutex> lock(mutex);
-        buffer.resize(0);
-    }
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer.reset();
     curPos = 0;
 }
 
@@ -32,9 +47,12 @@ size_t ZipFile::read(void* ptr, size_t bytes) {
     size_t bytesToRead, bytesRead;
 
     if (info.compressed) {
-        bytesToRead = std::min(buffer.size() - curPos, bytes);
+        size_t available = buffer ? buffer->size() : 0;
+        bytesToRead = std::min(available - std::min(available, curPos), bytes);
         bytesRead = bytesToRead;
-        std::copy(buffer.data() + curPos, buffer.data() + curPos + bytesToRead, static_cast<uint8_t*>(ptr));
+        if (bytesToRead > 0) {
+            std::copy(buffer->data() + curPos, buffer->data() + curPos + bytesToRead, static_cast<uint8_t*>(ptr));
+        }
     } else {
         bytesToRead = std::min(filesize - curPos, bytes);
         bytesRead = archive->extractBytesToBuffer(ptr, bytesToRead, info.offset + curPos);
@@ -63,4 +81,15 @@ int64_t ZipFile::tell() {
     return curPos;
 }
 
+std::shared_ptr<File> ZipFile::clone() const {
+    auto file = std::make_shared<ZipFile>(archive, path);
+    file->inflated = inflated;
+    return file;
+}
+
+// The CRC stored in the central directory, so nothing has to be inflated
+uint64_t ZipFile::fingerprint() const {
+    return info.crc32;
+}
+
 } // namespace Vfs
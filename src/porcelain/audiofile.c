@@ -10,6 +10,12 @@
 
 RECOMP_IMPORT(".", s32 AudioApi_AddAudioFileFromFs(AudioApiFileInfo* info, char* dir, char* filename));
 RECOMP_IMPORT(".", uintptr_t AudioApi_GetResourceDevAddr(u32 resourceId, u32 arg1, u32 arg2));
+RECOMP_IMPORT(".", bool AudioApiNative_GetVadpcmState(u32 resourceId, u32 trackNo, AdpcmBook* book, AdpcmLoop* loop));
+
+// Codebooks made by the native VADPCM encoder
+#define VADPCM_ORDER 2
+#define VADPCM_PREDICTORS 4
+#define VADPCM_BOOK_SIZE (sizeof(AdpcmBookHeader) + sizeof(s16) * 8 * VADPCM_ORDER * VADPCM_PREDICTORS)
 
 RECOMP_EXPORT s32 AudioApi_CreateStreamedSequence(AudioApiFileInfo* info) {
     u32 channelCount, trackCount;
@@ -18,6 +24,7 @@ RECOMP_EXPORT s32 AudioApi_CreateStreamedSequence(AudioApiFileInfo* info) {
     u16 length;
     uintptr_t sampleAddr;
     AdpcmLoop sampleLoop;
+    AdpcmBook* sampleBook = NULL;
     Sample sample;
     Instrument inst;
     size_t seqSize;
@@ -43,6 +50,10 @@ RECOMP_EXPORT s32 AudioApi_CreateStreamedSequence(AudioApiFileInfo* info) {
         return -1;
     }
 
+    // The codebook and loop state are copied along with the sample, so one buffer serves every track.
+    // Files streamed as PCM have no codebook and give it back after the first track.
+    sampleBook = recomp_alloc(VADPCM_BOOK_SIZE);
+
     fontId = AudioApi_CreateEmptySoundFont();
 
     for (trackNo = 0; trackNo < trackCount; trackNo++) {
@@ -53,14 +64,29 @@ RECOMP_EXPORT s32 AudioApi_CreateStreamedSequence(AudioApiFileInfo* info) {
             { info->loopStart, info->loopEnd, info->loopCount, info->sampleCount }, {}
         };
 
-        sample = (Sample){
-            0, CODEC_S16, MEDIUM_CART, false, false,
-            info->sampleCount * 2,
-            (void*)sampleAddr,
-            &sampleLoop,
-            NULL
-        };
+        if (sampleBook != NULL && AudioApiNative_GetVadpcmState(info->resourceId, trackNo, sampleBook, &sampleLoop)) {
+            sample = (Sample){
+                0, CODEC_ADPCM, MEDIUM_CART, false, false,
+                ((info->sampleCount + 15) / 16) * 9,
+                (void*)sampleAddr,
+                &sampleLoop,
+                sampleBook
+            };
+        } else {
+            if (sampleBook != NULL) {
+                recomp_free(sampleBook);
+                sampleBook = NULL;
+            }
+            sample = (Sample){
+                0, CODEC_S16, MEDIUM_CART, false, false,
+                info->sampleCount * 2,
+                (void*)sampleAddr,
+                &sampleLoop,
+                NULL
+            };
+        }
 
+        // Files resampled natively to 32000 Hz (AUDIOAPI_OPTION_RESAMPLE_RATE) play at a tuning of exactly 1.0
         inst = (Instrument){
             false,
             INSTR_SAMPLE_LO_NONE,
@@ -75,6 +101,10 @@ RECOMP_EXPORT s32 AudioApi_CreateStreamedSequence(AudioApiFileInfo* info) {
         AudioApi_AddInstrument(fontId, &inst);
     }
 
+    if (sampleBook != NULL) {
+        recomp_free(sampleBook);
+    }
+
     if (info->loopCount == -1) {
         length = 0x7FFF;
     } else {
@@ -0,0 +1,27 @@
+#include <global.h>
+#include <recomp/modding.h>
+
+#include <audio_api/types.h>
+
+RECOMP_IMPORT(".", bool AudioApiNative_SetOption(u32 option, u32 value));
+RECOMP_IMPORT(".", bool AudioApiNative_SetCacheQuota(char* dir, u32 bytes));
+RECOMP_IMPORT(".", u32 AudioApiNative_GetUnderrunCount(s32 resourceId));
+RECOMP_IMPORT(".", bool AudioApiNative_GetStats(s32 resourceId, AudioApiStats* stats));
+
+RECOMP_EXPORT bool AudioApi_SetOption(AudioApiOption option, u32 value) {
+    return AudioApiNative_SetOption(option, value);
+}
+
+RECOMP_EXPORT bool AudioApi_SetCacheQuota(char* dir, u32 bytes) {
+    return AudioApiNative_SetCacheQuota(dir, bytes);
+}
+
+// Pass a negative resourceId to get the total across all resources
+RECOMP_EXPORT u32 AudioApi_GetUnderrunCount(s32 resourceId) {
+    return AudioApiNative_GetUnderrunCount(resourceId);
+}
+
+// Pass a negative resourceId to get the totals across all resources
+RECOMP_EXPORT bool AudioApi_GetStats(s32 resourceId, AudioApiStats* stats) {
+    return AudioApiNative_GetStats(resourceId, stats);
+}
@@ -6,6 +6,7 @@
 RECOMP_IMPORT(".", bool AudioApiNative_AddResource(AudioApiResourceInfo* info, char* dir, char* filename));
 RECOMP_IMPORT(".", bool AudioApiNative_AddSampleBank(AudioApiSampleBankInfo* info, char* dir, char* filename));
 RECOMP_IMPORT(".", bool AudioApiNative_AddAudioFile(AudioApiFileInfo* info, char* dir, char* filename));
+RECOMP_IMPORT(".", u32 AudioApiNative_AddAudioFiles(AudioApiFileInfo* infos, char* dir, char** filenames, u32 count));
 RECOMP_IMPORT(".", uintptr_t AudioApi_AddDmaCallback(AudioApiDmaCallback callback, u32 arg0, u32 arg1, u32 arg2));
 RECOMP_IMPORT(".", s32 AudioApi_NativeDmaCallback(void* ramAddr, size_t size, size_t offset, u32 arg0, u32 arg1, u32 arg2));
 
@@ -47,6 +48,12 @@ RECOMP_EXPORT bool AudioApi_AddAudioFileFromFs(AudioApiFileInfo* info, char* dir
     return AudioApiNative_AddAudioFile(info, dir, filename);
 }
 
+// Probes all files in parallel and returns how many were added. Failed entries get
+// AUDIOAPI_INVALID_RESOURCE_ID as their resourceId.
+RECOMP_EXPORT u32 AudioApi_AddAudioFilesFromFs(AudioApiFileInfo* infos, char* dir, char** filenames, u32 count) {
+    return AudioApiNative_AddAudioFiles(infos, dir, filenames, count);
+}
+
 RECOMP_EXPORT uintptr_t AudioApi_GetResourceDevAddr(u32 resourceId, u32 arg1, u32 arg2) {
     return AudioApi_AddDmaCallback(AudioApi_NativeDmaCallback, resourceId, arg1, arg2);
 }